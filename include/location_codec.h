@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+namespace computational_geometry {
+
+typedef std::array<float, 3> Vector3D;
+
+/// Lossy compressed sequence of locations (quantized delta encoding).
+/// Locations are quantized to the grid around the base point (the first location) with step 2 * tolerance.
+/// Coordinates are restored in double precision and encode() checks every one of them: if rounding to float
+/// breaks tolerance, the step is reduced by float spacing of the largest coordinate, and encoding fails when
+/// float spacing of coordinates is too coarse for the tolerance. Each location is stored as 32-bit code: quantized delta
+/// from the previous location along the single changed axis, or index of full quantized location if several
+/// axes change.
+/// Absolute locations are kept every kCheckpointStep locations for random access.
+class EncodedLocations {
+  public:
+    /// Quantized offset of location from the base point, state of sequential decoding.
+    typedef std::array<int32_t, 3> State;
+
+    explicit EncodedLocations(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : m_codes(resource), m_checkpoints(resource), m_escapes(resource) {}
+    EncodedLocations(const EncodedLocations& other, std::pmr::memory_resource* resource)
+        : m_base(other.m_base), m_step(other.m_step), m_codes(other.m_codes, resource), m_checkpoints(other.m_checkpoints, resource),
+          m_escapes(other.m_escapes, resource) {}
+
+    /// @brief Encode locations with given tolerance, replaces previous content.
+    /// @returns false if quantized offsets from the base point do not fit 32-bit integers or some restored
+    /// coordinate is not within tolerance, nothing is encoded then.
+    bool encode(const Vector3D* locations, int n_locations, float tolerance);
+
+    /// @returns number of encoded locations.
+    int size() const { return m_codes.size(); }
+    bool empty() const { return m_codes.empty(); }
+
+    /// @returns location with given index, O(kCheckpointStep).
+    Vector3D get(int index) const { return toLocation(stateAt(index)); }
+
+    /// @returns decoding state (quantized offset from the base point) at given index, O(kCheckpointStep).
+    State stateAt(int index) const;
+
+    /// @brief Move decoding state from location index - 1 to location index, O(1).
+    void advance(State& state, int index) const {
+      uint32_t code = m_codes[index];
+      int axis = code & kAxisMask;
+      if (axis == kEscapeAxis) {
+        state = m_escapes[code >> kAxisBits];
+      } else {
+        state[axis] += static_cast<int32_t>(code) >> kAxisBits;
+      }
+    }
+
+    /// @returns location corresponding to decoding state.
+    Vector3D toLocation(const State& state) const {
+      return Vector3D{toCoordinate(state[0], 0), toCoordinate(state[1], 1), toCoordinate(state[2], 2)};
+    }
+
+    /// @brief Decode count locations starting from first into structure-of-arrays buffers.
+    /// Codes are expanded to quantized offsets block by block, then coordinates of the block are scaled
+    /// and shifted by the base point in branch-free loops the compiler vectorizes.
+    void decode(int first, int count, float* x, float* y, float* z) const;
+
+    /// @brief Decode count locations starting from first into array of locations.
+    void decode(int first, int count, Vector3D* locations) const;
+
+    /// @returns memory used by encoded locations in bytes.
+    size_t memoryUsage() const;
+
+  private:
+    /// @brief Encode locations quantized with given step.
+    /// @returns false if some offset does not fit or restored coordinate is not within tolerance, nothing is encoded then.
+    bool encodeWithStep(const Vector3D* locations, int n_locations, double step, float tolerance);
+
+    /// @returns coordinate along given axis corresponding to quantized offset, computed in double precision.
+    float toCoordinate(int32_t offset, int axis) const {
+      return static_cast<float>(m_base[axis] + static_cast<double>(offset) * m_step);
+    }
+
+    /// @brief Number of locations expanded at once by structure-of-arrays decode().
+    static constexpr int kDecodeBlockSize = 256;
+
+    /// @brief Distance between absolute checkpoints.
+    static constexpr int kCheckpointStep = 32;
+
+    /// @brief Code layout: lower bits - changed axis (or escape), upper bits - signed delta (or escape index).
+    static constexpr int kAxisBits = 2;
+    static constexpr uint32_t kAxisMask = (1u << kAxisBits) - 1;
+    static constexpr int kEscapeAxis = 3;
+
+    /// @brief Base point, locations are quantized relative to it.
+    Vector3D m_base{0., 0., 0.};
+
+    /// @brief Quantization step.
+    double m_step{1.};
+
+    /// @brief Code of each location.
+    std::pmr::vector<uint32_t> m_codes;
+
+    /// @brief Quantized offset at every kCheckpointStep-th index.
+    std::pmr::vector<State> m_checkpoints;
+
+    /// @brief Quantized offsets referenced by escape codes.
+    std::pmr::vector<State> m_escapes;
+};
+
+} // namespace computational_geometry
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace computational_geometry {
+
+/// String interning pool with stable ids.
+/// Strings are stored in contiguous character arena, ids are assigned in order of insertion
+/// and never change, lookup by string is done through open addressing hash table.
+/// Copies of the pool share its content, shared content is never modified: it is copied
+/// by the first modification of a copy (copy-on-write), so copying the pool is O(1).
+class StringPool {
+  public:
+    StringPool() {}
+
+    /// @returns number of strings in the pool.
+    int size() const { return content().spans.size(); }
+
+    /// @brief Add string to the pool if it is not there yet.
+    /// @returns id of the string.
+    int intern(std::string_view str);
+
+    /// @brief Add new id for the string, the same as intern() for new string
+    /// and new alias id sharing existing characters if the string is already in the pool.
+    /// @returns new id (always equal to size() before the call).
+    int add(std::string_view str);
+
+    /// @returns id of the string (first one assigned to it), -1 if string is not in the pool.
+    int find(std::string_view str) const;
+
+    /// @returns string with given id, view is valid until next modification of the pool.
+    std::string_view get(int id) const;
+
+    /// @brief Append all ids of other pool, ids of other strings are shifted by size() before the call.
+    /// Strings which are already in the pool get alias ids sharing the existing characters.
+    /// @returns id offset of appended strings.
+    int append(const StringPool& other);
+
+    /// @brief utility to clear all the strings.
+    void clear();
+
+  private:
+    /// Position of string in the arena.
+    struct Span {
+      size_t offset{0};
+      size_t length{0};
+    };
+
+    /// Strings and hash table, shared between copies of the pool.
+    struct Content {
+      /// @brief Contiguous storage of all strings characters.
+      std::vector<char> arena;
+
+      /// @brief Positions of strings in arena by id, alias ids share position with the original id.
+      std::vector<Span> spans;
+
+      /// @brief Hash values of strings by id (to avoid re-hashing on table growth).
+      std::vector<size_t> hashes;
+
+      /// @brief Open addressing hash table of ids (aliases are not there), -1 for empty slot. Size is power of two.
+      std::vector<int> slots;
+    };
+
+    /// @returns content for reading.
+    const Content& content() const;
+
+    /// @returns content for modification, duplicates it if it is shared with other pool.
+    Content& mutableContent();
+
+    /// @returns slot in hash table where string is stored or should be inserted.
+    int findSlot(std::string_view str, size_t hash) const;
+
+    /// @brief Grow hash table and re-insert all ids it contains.
+    void rehash(int n_slots);
+
+    /// @brief Pool content, null for empty pool.
+    std::shared_ptr<Content> m_content;
+};
+
+} // namespace computational_geometry
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+namespace computational_geometry {
+
+typedef std::vector<std::vector<std::vector<float>>> Data3D;
+
+/// Read-only view of dense 3D tensor of floats (row-major, last index is contiguous).
+class Tensor3DView {
+  public:
+    Tensor3DView() {}
+    Tensor3DView(const float* values, const std::array<int, 3>& dims) : m_values(values), m_dims(dims) {}
+
+    /// @returns size of the tensor along given dimension.
+    int size(int dim) const { return m_dims[dim]; }
+
+    /// @returns sizes of the tensor along all dimensions.
+    const std::array<int, 3>& dims() const { return m_dims; }
+
+    /// @returns total number of elements.
+    size_t numElements() const { return static_cast<size_t>(m_dims[0]) * m_dims[1] * m_dims[2]; }
+
+    /// @returns pointer to contiguous tensor elements.
+    const float* data() const { return m_values; }
+
+    /// @returns element at given indices.
+    float operator()(int i, int j, int k) const { return m_values[(static_cast<size_t>(i) * m_dims[1] + j) * m_dims[2] + k]; }
+
+    /// @brief Conversion to nested vectors representation.
+    Data3D toData3D() const;
+
+  private:
+    /// @brief Tensor elements.
+    const float* m_values{nullptr};
+
+    /// @brief Tensor sizes.
+    std::array<int, 3> m_dims{0, 0, 0};
+};
+
+/// Arena of dense 3D tensors: tensors elements are stored in a few large contiguous float blocks.
+/// Tensors are identified by id assigned in order of insertion.
+/// Byte-identical tensors are stored once: id of repeated tensor refers to elements of the first copy,
+/// copies are found through open addressing hash table of content hashes.
+/// Copies of arena share blocks, shared blocks are never modified: new tensors go to a new block.
+/// Tensors table is shared as well and copied by the first modification of a copy (copy-on-write),
+/// so copying the arena is O(number of blocks).
+/// Blocks are allocated from memory resource given on construction.
+class TensorArena {
+  public:
+    explicit TensorArena(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) : m_resource(resource) {}
+    TensorArena(const TensorArena&) = default;
+    TensorArena& operator=(const TensorArena&) = default;
+
+    /// @brief Move tensors of other arena, blocks are not copied. Other arena is left empty.
+    TensorArena(TensorArena&& other) noexcept
+        : m_blocks(std::move(other.m_blocks)), m_table(std::move(other.m_table)), m_resource(other.m_resource) {
+      other.clear();
+    }
+
+    TensorArena& operator=(TensorArena&& other) noexcept {
+      m_blocks = std::move(other.m_blocks);
+      m_table = std::move(other.m_table);
+      m_resource = other.m_resource;
+      other.clear();
+      return *this;
+    }
+
+    /// @returns number of tensors in the arena.
+    int size() const { return table().entries.size(); }
+
+    /// @brief Add tensor given in nested vectors representation, it must be rectangular.
+    /// @returns id of the new tensor (always equal to size() before the call).
+    int add(const Data3D& data);
+
+    /// @brief Add copy of tensor.
+    /// @returns id of the new tensor (always equal to size() before the call).
+    int add(const Tensor3DView& tensor);
+
+    /// @returns view of tensor with given id, view is valid until next modification of the arena.
+    Tensor3DView get(int id) const;
+
+    /// @brief Append all tensors of other arena, ids of other tensors are shifted by size() before the call.
+    /// Blocks of other arena are moved, tensor elements are not copied (nor deduplicated),
+    /// appended tensors are hashed on the next add().
+    /// @returns id offset of appended tensors.
+    /// @note other arena is cleared.
+    int append(TensorArena&& other);
+
+    /// @brief Append all tensors of several arenas in parallel, like sequence of append() calls.
+    /// @returns id offset of appended tensors for each of other arenas.
+    /// @note other arenas are cleared.
+    std::vector<int> appendAll(const std::vector<TensorArena*>& others);
+
+    /// @brief Reserve memory for given number of tensors and blocks.
+    void reserve(int n_tensors, int n_blocks);
+
+    /// @returns number of blocks.
+    int numBlocks() const { return m_blocks.size(); }
+
+    /// @returns memory used by tensor elements in bytes (shared blocks are counted as well).
+    size_t memoryUsage() const;
+
+    /// @brief Resize containers to actual capacity to optimize memory.
+    void shrinkToFit();
+
+    /// @brief utility to clear all the tensors and release memory.
+    void clear();
+
+  private:
+    /// @brief Number of elements after which new block is started.
+    static constexpr size_t kBlockSize = size_t(1) << 20;
+
+    /// Position and sizes of tensor in m_blocks.
+    struct Entry {
+      int block{0};
+      size_t offset{0};
+      std::array<int, 3> dims{0, 0, 0};
+    };
+
+    /// Tensors by id and hash table, shared between copies of the arena.
+    struct Table {
+      /// @brief Tensors by id.
+      std::vector<Entry> entries;
+
+      /// @brief Hash values of tensors by id, for ids [0, n_hashed).
+      std::vector<size_t> hashes;
+
+      /// @brief Open addressing hash table of ids (repeated tensors are not there), -1 for empty slot.
+      /// Size is power of two.
+      std::vector<int> slots;
+
+      /// @brief Number of hashed tensors, tensors appended from other arenas are hashed lazily.
+      int n_hashed{0};
+    };
+
+    /// @returns tensors table for reading.
+    const Table& table() const;
+
+    /// @returns tensors table for modification, duplicates it if it is shared with other arena.
+    Table& mutableTable();
+
+    /// @brief Add entry for new tensor of given sizes.
+    /// @returns pointer to elements of new tensor to be filled in.
+    float* allocate(const std::array<int, 3>& dims);
+
+    /// @brief Look up the last added tensor in hash table: if the same tensor is already in the arena,
+    /// elements of the new one are released and its entry refers to the existing copy.
+    /// @returns id of the last added tensor.
+    int deduplicateLast();
+
+    /// @brief Add tensors [n_hashed, end_id) to hash table.
+    void hashEntries(int end_id);
+
+    /// @returns slot in hash table where tensor is stored or should be inserted.
+    int findSlot(const Tensor3DView& tensor, size_t hash) const;
+
+    /// @brief Grow hash table and re-insert all ids it contains.
+    void rehash(int n_slots);
+
+    /// @returns hash of tensor sizes and elements bytes.
+    static size_t hashTensor(const Tensor3DView& tensor);
+
+    /// @brief Contiguous blocks of tensors elements, shared between copies of the arena.
+    std::vector<std::shared_ptr<std::pmr::vector<float>>> m_blocks;
+
+    /// @brief Tensors table, null for empty arena.
+    std::shared_ptr<Table> m_table;
+
+    /// @brief Memory resource for blocks.
+    std::pmr::memory_resource* m_resource{std::pmr::get_default_resource()};
+};
+
+} // namespace computational_geometry
@@ -1,15 +1,37 @@
 #pragma once
 
 #include <array>
-#include <list>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
 #include <optional>
-#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
+#include <location_codec.h>
+#include <string_pool.h>
+#include <tensor_arena.h>
+
 namespace computational_geometry {
 
-typedef std::array<float, 3> Vector3D;
-typedef std::vector<std::vector<std::vector<float>>> Data3D;
+/// @returns true if memory resource can be used from several threads at once,
+/// parallel loops which allocate or release memory are run sequentially otherwise.
+inline bool isThreadSafeResource(const std::pmr::memory_resource* resource) {
+  return resource == std::pmr::new_delete_resource();
+}
+
+/// Type of path point indices and path sizes. Paths are limited to 2^31 - 1 points by default,
+/// TOOL_PATH_INDEX_64 compile definition (CMake option of the same name) switches to 64-bit indices
+/// for multi-billion point paths. Offsets in chunks, chunk indices and comment and data ids stay 32-bit.
+#ifdef TOOL_PATH_INDEX_64
+typedef int64_t ToolPathIndex;
+#else
+typedef int32_t ToolPathIndex;
+#endif
 
 /// Tool path point metadata class.
 class ToolPathPointMetaData {
@@ -32,31 +54,216 @@ class ToolPathPointMetaData {
     int m_data_index{-1};
 };
 
-/// Tool path point class.
-class ToolPathPoint {
+/// Chunk of consecutive path points, building block of ToolPath segmented storage.
+/// Path points have no per-point storage: locations are run-length encoded,
+/// metadata is kept in sparse side-table for the few points which have it.
+/// Location runs and metadata side-table are shared between copies of the chunk
+/// and duplicated only when one of the copies is modified (copy-on-write).
+/// Run locations can be compressed with lossy EncodedLocations codec, compressed chunk is decoded back
+/// when its runs are modified. Tables are allocated from memory resource of the chunk.
+class ToolPathChunk {
   public:
-    ToolPathPoint() {}
+    ToolPathChunk() {}
+    explicit ToolPathChunk(int n_points, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : m_n_points(n_points), m_resource(resource) {}
 
-    /// @brief set location index in ToolPath::m_locations.
-    void setLocationIndex(int location_index);
+    /// @returns memory resource tables of the chunk are allocated from.
+    std::pmr::memory_resource* memoryResource() const { return m_resource; }
 
-    /// @brief get location index in ToolPath::m_locations.
-    int getLocationIndex() const { return m_location_index; }
+    /// @returns number of path points in the chunk.
+    int numPoints() const { return m_n_points; }
 
-    /// @brief set comment index in ToolPath::m_comments.
-    void setCommentIndex(int comment_index);
+    /// @returns number of location runs started in the chunk.
+    int numLocationRuns() const { return runs().starts.size(); }
+
+    /// @returns number of path points with metadata in the chunk.
+    int numMetaData() const { return metadataTable().offsets.size(); }
 
-    /// @brief set data index in ToolPath::m_data.
-    void setDataIndex(int data_index);
-  
   private:
-    // Index of location (in ToolPath::m_locations) this point has inherited location from.
-    int m_location_index{-1};
+    /// Run-length encoded locations.
+    struct LocationRuns {
+      explicit LocationRuns(std::pmr::memory_resource* resource)
+          : starts(resource), locations(resource), encoded(resource) {}
+      LocationRuns(const LocationRuns& other, std::pmr::memory_resource* resource)
+          : starts(other.starts, resource), locations(other.locations, resource), encoded(other.encoded, resource) {}
+
+      /// @returns true if run locations are compressed.
+      bool isEncoded() const { return !encoded.empty(); }
+
+      /// @returns location of given run, O(1) for plain and O(EncodedLocations checkpoint step) for compressed runs.
+      Vector3D location(int run_index) const { return isEncoded() ? encoded.get(run_index) : locations[run_index]; }
+
+      /// @brief Sorted offsets of path points where location changes (run starts).
+      /// Points before the first run of the chunk inherit location of the last run in previous chunks.
+      std::pmr::vector<int> starts;
+
+      /// @brief Location of each run, locations[i] corresponds to starts[i], empty if runs are compressed.
+      std::pmr::vector<Vector3D> locations;
+
+      /// @brief Compressed location of each run, empty unless runs are compressed.
+      EncodedLocations encoded;
+
+      /// @brief Number of times runs were given out for modification by mutableRuns(),
+      /// lets observers holding weak references (see ToolPathSpatialIndex) detect in-place changes.
+      uint64_t version{0};
+    };
+
+    /// Sparse metadata side-table.
+    struct MetaDataTable {
+      explicit MetaDataTable(std::pmr::memory_resource* resource) : offsets(resource), metadata(resource) {}
+      MetaDataTable(const MetaDataTable& other, std::pmr::memory_resource* resource)
+          : offsets(other.offsets, resource), metadata(other.metadata, resource) {}
+
+      /// @brief Sorted offsets of path points with metadata.
+      std::pmr::vector<int> offsets;
+
+      /// @brief Metadata of each point in offsets.
+      std::pmr::vector<ToolPathPointMetaData> metadata;
+    };
+
+    /// @returns new empty location runs allocated from m_resource.
+    std::shared_ptr<LocationRuns> makeRuns() const;
+
+    /// @returns new empty metadata side-table allocated from m_resource.
+    std::shared_ptr<MetaDataTable> makeMetaDataTable() const;
+
+    /// @returns location runs for reading.
+    const LocationRuns& runs() const;
+
+    /// @returns location runs for modification, duplicates them if they are shared with other chunk.
+    /// Compressed runs are decoded, version of the runs is incremented.
+    LocationRuns& mutableRuns();
+
+    /// @brief Compress run locations with given tolerance, runs are left plain if they can not be encoded.
+    void encodeLocations(float tolerance);
+
+    /// @brief Replace compressed runs with plain ones.
+    void decodeLocations();
+
+    /// @returns metadata side-table for reading.
+    const MetaDataTable& metadataTable() const;
 
-    // Data associated with this path point.
-    std::optional<ToolPathPointMetaData> m_data{std::nullopt};
+    /// @returns metadata side-table for modification, duplicates it if it is shared with other chunk.
+    MetaDataTable& mutableMetaDataTable();
+
+    /// @brief Find location run covering given offset.
+    /// @returns run index in runs(), -1 if offset precedes the first run of the chunk.
+    int findLocationRun(int offset) const;
+
+    /// @brief Start new location run at given offset (or update location of the run starting there).
+    void setLocation(int offset, const Vector3D& location);
+
+    /// @brief Apply m_comment_base and m_data_base to metadata indices and reset them.
+    void resolveBases();
+
+    /// @returns metadata of path point at given offset, nullptr if point has no metadata.
+    /// @note Returned indices are relative to m_comment_base and m_data_base.
+    const ToolPathPointMetaData* findMetaData(int offset) const;
+
+    /// @returns metadata of path point at given offset, adds empty one if point has no metadata.
+    ToolPathPointMetaData& getOrAddMetaData(int offset);
+
+    /// @brief Insert new path point at given offset, shifts runs and metadata of following points.
+    /// @note New point inherits location of the previous point.
+    void insertPoint(int offset);
+
+    /// @brief Insert new path points in one merge pass over runs and metadata.
+    /// @param offsets sorted offsets of existing points new points are inserted before (numPoints() for the end).
+    /// @param locations location of each new point.
+    /// @param metadata metadata of each new point, entries with no comment and no data are skipped.
+    void insertPoints(const std::vector<int>& offsets, const std::vector<Vector3D>& locations,
+                      const std::vector<ToolPathPointMetaData>& metadata);
+
+    /// @brief Move points starting from given offset to the new chunk.
+    /// @returns new chunk with the tail of points.
+    ToolPathChunk splitTail(int offset);
+
+    /// @brief Erase points [first, last), runs and metadata of following points are shifted.
+    /// @note Runs starting in the erased range are dropped, following points inherit location of the previous run.
+    void erasePoints(int first, int last);
+
+    /// @brief Append points of other chunk to the end of the chunk, chunk bases of both chunks must be resolved.
+    void appendPoints(ToolPathChunk& other);
+
+    /// @brief Number of path points.
+    int m_n_points{0};
+
+    /// @brief Location runs, nullptr if chunk has no runs.
+    std::shared_ptr<LocationRuns> m_runs;
+
+    /// @brief Metadata side-table, nullptr if chunk has no metadata.
+    std::shared_ptr<MetaDataTable> m_metadata_table;
+
+    /// @brief Memory resource for location runs and metadata side-table.
+    std::pmr::memory_resource* m_resource{std::pmr::get_default_resource()};
+
+    /// @brief Offsets to be added to comment and data indices in metadata side-table,
+    /// allows to splice chunks between paths without touching metadata.
+    int m_comment_base{0};
+    int m_data_base{0};
 
     friend class ToolPath;
+    template <typename Attributes>
+    friend class BasicToolPathConstIterator;
+    friend class ToolPathPointRef;
+    friend class ToolPathBuilder;
+    friend class ToolPathSnapshot;
+    friend class ToolPathSpatialIndex;
+    friend class ToolPathJournal;
+};
+
+/// Order-statistics index over chunk sizes (Fenwick tree).
+/// Maps point index to (chunk index, offset in chunk) in O(log n_chunks).
+class ToolPathChunkIndex {
+  public:
+    ToolPathChunkIndex() {}
+    ToolPathChunkIndex(const ToolPathChunkIndex&) = default;
+    ToolPathChunkIndex& operator=(const ToolPathChunkIndex&) = default;
+
+    /// @brief Move constructor and assignment, other index is left empty.
+    ToolPathChunkIndex(ToolPathChunkIndex&& other) noexcept
+        : m_tree(std::move(other.m_tree)), m_top_bit(std::exchange(other.m_top_bit, 0)),
+          m_n_points(std::exchange(other.m_n_points, 0)) {
+      other.m_tree.clear();
+    }
+    ToolPathChunkIndex& operator=(ToolPathChunkIndex&& other) noexcept {
+      m_tree = std::move(other.m_tree);
+      other.m_tree.clear();
+      m_top_bit = std::exchange(other.m_top_bit, 0);
+      m_n_points = std::exchange(other.m_n_points, 0);
+      return *this;
+    }
+
+    /// @brief Rebuild index from scratch, O(n_chunks).
+    void build(const std::vector<ToolPathChunk>& chunks);
+
+    /// @brief Add new chunk at the end, O(log n_chunks).
+    void push_back(int chunk_size);
+
+    /// @brief Update size of the given chunk by delta.
+    void add(int chunk_index, int delta);
+
+    /// @brief Find chunk containing given point.
+    /// @param point_index index of path point, must be in [0, numPoints()).
+    /// @param offset (output) offset of path point in the found chunk.
+    /// @returns chunk index.
+    int find(ToolPathIndex point_index, int& offset) const;
+
+    /// @returns number of path points in chunks before given one, O(log n_chunks).
+    ToolPathIndex firstPoint(int chunk_index) const;
+
+    /// @returns total number of path points in all chunks.
+    ToolPathIndex numPoints() const { return m_n_points; }
+
+  private:
+    /// @brief Fenwick tree of chunk sizes (1-based), empty if index has no chunks.
+    std::vector<ToolPathIndex> m_tree;
+
+    /// @brief Highest power of two not exceeding number of chunks.
+    int m_top_bit{0};
+
+    /// @brief Total number of path points.
+    ToolPathIndex m_n_points{0};
 };
 
 /// Structure for path point data, used for queries.
@@ -71,90 +278,474 @@ struct ToolPathPointInfo {
   std::optional<Data3D> data{std::nullopt};
 };
 
+/// Lightweight view of path point data, used for queries without copying.
+/// @note comment and data views are valid until next modification of ToolPath.
+struct ToolPathPointView {
+  /// @brief Actual location of path point.
+  Vector3D location;
+
+  /// @brief Comment string (if assigned).
+  std::optional<std::string_view> comment{std::nullopt};
+
+  /// @brief Data.
+  std::optional<Tensor3DView> data{std::nullopt};
+};
+
+/// Caller-provided structure-of-arrays buffers for batch reads of path points (see ToolPath::gather()).
+/// Element i of each buffer corresponds to i-th point of the batch.
+struct ToolPathPointBatch {
+  /// @returns number of 64-bit words in presence bitmap of given number of points.
+  static size_t numBitmapWords(size_t n_points) { return (n_points + 63) / 64; }
+
+  /// @returns true if bit of i-th point is set in presence bitmap.
+  static bool test(const uint64_t* bitmap, size_t i) { return (bitmap[i / 64] >> (i % 64)) & 1; }
+
+  /// @brief Location coordinates, n_points elements each.
+  float* x{nullptr};
+  float* y{nullptr};
+  float* z{nullptr};
+
+  /// @brief Optional bitmaps of points having comment and data, numBitmapWords(n_points) words each
+  /// (overwritten by batch reads), nullptr if not needed.
+  uint64_t* has_comment{nullptr};
+  uint64_t* has_data{nullptr};
+};
+
+/// Structure describing new path point for bulk insertion.
+struct ToolPathPointInsertion {
+  /// @brief Index of existing path point the new point is inserted before, numPoints() to insert at the end.
+  ToolPathIndex point_index{0};
+
+  /// @brief Location of new path point, following points inherit it until next location change.
+  Vector3D location;
+
+  /// @brief Comment string (if assigned).
+  std::optional<std::string> comment{std::nullopt};
+
+  /// @brief Data (if assigned).
+  std::optional<Data3D> data{std::nullopt};
+};
+
+class ToolPath;
+class ToolPathJournal;
+
+/// Attribute policies of path point readers (iterators and ranges): attributes which are not selected
+/// are not looked up, comment and data of views of such readers are never set. Locations are always read.
+/// Paths with no comments or no data, or readers which do not need them, skip metadata cursors entirely.
+struct ToolPathLocationsOnly {
+  static constexpr bool kComments = false;
+  static constexpr bool kData = false;
+};
+
+struct ToolPathWithComments {
+  static constexpr bool kComments = true;
+  static constexpr bool kData = false;
+};
+
+struct ToolPathWithData {
+  static constexpr bool kComments = false;
+  static constexpr bool kData = true;
+};
+
+struct ToolPathAllAttributes {
+  static constexpr bool kComments = true;
+  static constexpr bool kData = true;
+};
+
+/// Bidirectional iterator over path points of ToolPath, dereferences to ToolPathPointView.
+/// Location run and metadata cursors are kept in the iterator, so that moving to the neighbour point is O(1).
+/// Attributes policy selects attributes of the view, metadata cursor is not maintained if it selects none.
+/// @note Iterator is invalidated by any modification of ToolPath.
+/// @note Iterator is instantiated for the attribute policies above.
+template <typename Attributes>
+class BasicToolPathConstIterator {
+  public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = ToolPathPointView;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const ToolPathPointView*;
+    using reference = const ToolPathPointView&;
+
+    BasicToolPathConstIterator() {}
+
+    /// @returns index of path point iterator points to.
+    ToolPathIndex pointIndex() const { return m_point_index; }
+
+    reference operator*() const { return m_view; }
+    pointer operator->() const { return &m_view; }
+
+    BasicToolPathConstIterator& operator++();
+    BasicToolPathConstIterator operator++(int) { auto result = *this; ++(*this); return result; }
+    BasicToolPathConstIterator& operator--();
+    BasicToolPathConstIterator operator--(int) { auto result = *this; --(*this); return result; }
+
+    bool operator==(const BasicToolPathConstIterator& other) const { return m_point_index == other.m_point_index; }
+    bool operator!=(const BasicToolPathConstIterator& other) const { return m_point_index != other.m_point_index; }
+
+  private:
+    /// @brief true if metadata of path points is read.
+    static constexpr bool kMetaData = Attributes::kComments || Attributes::kData;
+
+    /// @brief Iterator pointing to given path point, numPoints() for the end.
+    BasicToolPathConstIterator(const ToolPath* tool_path, ToolPathIndex point_index);
+
+    /// @brief Find cursors for current chunk and offset from scratch.
+    void seek();
+
+    /// @brief Update comment and data of m_view from metadata cursor.
+    void updateView();
+
+    const ToolPath* m_tool_path{nullptr};
+
+    /// @brief Position of path point: chunk index and offset in chunk.
+    int m_chunk_index{0};
+    int m_offset{0};
+    ToolPathIndex m_point_index{0};
+
+    /// @brief Location run covering current point in the chunk, -1 if location is inherited from previous chunks.
+    int m_run_index{-1};
+
+    /// @brief Index of first metadata of the chunk at or after current point.
+    int m_metadata_index{0};
+
+    /// @brief Decoding state of m_run_index run if runs of the chunk are compressed.
+    EncodedLocations::State m_encoded_state;
+
+    /// @brief View of current point.
+    ToolPathPointView m_view;
+
+    friend class ToolPath;
+    template <typename OtherAttributes>
+    friend class BasicToolPathRange;
+};
+
+/// Iterator reading all attributes of path points.
+typedef BasicToolPathConstIterator<ToolPathAllAttributes> ToolPathConstIterator;
+
+/// Reference to path point of ToolPath returned by mutable iterator.
+class ToolPathPointRef {
+  public:
+    /// @returns index of referenced path point.
+    ToolPathIndex pointIndex() const { return m_point_index; }
+
+    /// @returns view of path point data.
+    ToolPathPointView view() const;
+    operator ToolPathPointView() const { return view(); }
+
+    /// @brief Update location, comment or data of path point.
+    void setLocation(const Vector3D& location);
+    void setComment(std::string_view comment_str);
+    void setData(const Data3D& values);
+    void setData(const Tensor3DView& values);
+
+  private:
+    ToolPathPointRef(ToolPath* tool_path, int chunk_index, int offset, ToolPathIndex point_index)
+        : m_tool_path(tool_path), m_chunk_index(chunk_index), m_offset(offset), m_point_index(point_index) {}
+
+    ToolPath* m_tool_path;
+    int m_chunk_index;
+    int m_offset;
+    ToolPathIndex m_point_index;
+
+    friend class ToolPathIterator;
+};
+
+/// Bidirectional iterator over path points of ToolPath, dereferences to ToolPathPointRef
+/// which allows to update referenced point.
+/// @note Iterator stays valid while path points are updated through it, it is invalidated by insertions.
+class ToolPathIterator {
+  public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = ToolPathPointView;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = ToolPathPointRef;
+
+    ToolPathIterator() {}
+
+    /// @returns index of path point iterator points to.
+    ToolPathIndex pointIndex() const { return m_point_index; }
+
+    reference operator*() const { return ToolPathPointRef(m_tool_path, m_chunk_index, m_offset, m_point_index); }
+
+    ToolPathIterator& operator++();
+    ToolPathIterator operator++(int) { auto result = *this; ++(*this); return result; }
+    ToolPathIterator& operator--();
+    ToolPathIterator operator--(int) { auto result = *this; --(*this); return result; }
+
+    bool operator==(const ToolPathIterator& other) const { return m_point_index == other.m_point_index; }
+    bool operator!=(const ToolPathIterator& other) const { return m_point_index != other.m_point_index; }
+
+  private:
+    /// @brief Iterator pointing to given path point, numPoints() for the end.
+    ToolPathIterator(ToolPath* tool_path, ToolPathIndex point_index);
+
+    ToolPath* m_tool_path{nullptr};
+
+    /// @brief Position of path point: chunk index and offset in chunk.
+    int m_chunk_index{0};
+    int m_offset{0};
+    ToolPathIndex m_point_index{0};
+
+    friend class ToolPath;
+};
+
+/// Range of consecutive path points [first, last) of ToolPath, can be split into balanced
+/// sub-ranges for parallel processing. Attributes policy selects attributes read by range iterators.
+/// @note Range is invalidated by insertions into ToolPath.
+template <typename Attributes>
+class BasicToolPathRange {
+  public:
+    BasicToolPathRange(const ToolPath& tool_path, ToolPathIndex first_point_index, ToolPathIndex last_point_index);
+
+    BasicToolPathConstIterator<Attributes> begin() const;
+    BasicToolPathConstIterator<Attributes> end() const;
+
+    /// @returns number of path points in the range.
+    ToolPathIndex size() const { return m_last - m_first; }
+    bool empty() const { return m_first == m_last; }
+
+    /// @returns index of the first path point and index after the last path point of the range.
+    ToolPathIndex firstPointIndex() const { return m_first; }
+    ToolPathIndex lastPointIndex() const { return m_last; }
+
+    /// @brief Split range into n_parts sub-ranges of equal size (up to one point), empty parts are skipped.
+    std::vector<BasicToolPathRange> split(int n_parts) const;
+
+  private:
+    const ToolPath* m_tool_path;
+    ToolPathIndex m_first;
+    ToolPathIndex m_last;
+};
+
+/// Range reading all attributes of path points.
+typedef BasicToolPathRange<ToolPathAllAttributes> ToolPathRange;
+
 /// Top-level class for ToolPath object.
+/// Location runs, metadata and data of the path are allocated from memory resource given on construction
+/// (monotonic or pool arena allows to release the whole path at once). Memory resource must outlive the path,
+/// its copies and paths its chunks are moved to by append() or insert().
 class ToolPath {
   public:
-    ToolPath(int n_points);
+    ToolPath(ToolPathIndex n_points, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    /// @brief Copy constructor, O(n_chunks): location runs, metadata and data blocks are shared
+    /// with other_tool_path and duplicated chunk by chunk only when modified, comments pool and
+    /// tensors table are shared until the first modification as well.
     ToolPath(const ToolPath& other_tool_path);
+    /// @brief Move constructor, O(1): chunks, pools and attached journal are taken over,
+    /// other_tool_path is left empty.
+    ToolPath(ToolPath&& other_tool_path) noexcept;
     /// @brief Constructor to combine vector of paths in a single path assuming the order in vector.
+    /// Chunks are moved in parallel without allocations, input paths are released sequentially,
+    /// so paths may use memory resources which are not thread-safe.
     /// @param other_tool_paths tool paths to combine
     /// @note Input vector of paths is being cleaned up.
     ToolPath(std::vector<ToolPath>& other_tool_paths);
+    ToolPath(std::vector<ToolPath>&& other_tool_paths) : ToolPath(other_tool_paths) {}
+
+    /// @brief Copy assignment, O(n_chunks) like copy constructor. Attached journal records the new contents.
+    ToolPath& operator=(const ToolPath& other_tool_path);
+
+    /// @brief Move assignment, O(1), other_tool_path is left empty and its journal follows the contents.
+    /// If this path has attached journal, the journal is kept and records the new contents like in copy
+    /// assignment (O(n_points) of other_tool_path), journal of other_tool_path records that it is cleared.
+    /// @throws std::runtime_error if attached journal can not be written.
+    ToolPath& operator=(ToolPath&& other_tool_path);
 
     /// @returns number of path points.
-    int numPoints() const {return m_path.size();}
+    ToolPathIndex numPoints() const {return m_chunk_index.numPoints();}
+
+    /// @returns memory resource of the path.
+    std::pmr::memory_resource* memoryResource() const { return m_resource; }
 
     /// @brief Update location for the given path point.
-    void setLocation(int point_index, const Vector3D& location);
+    void setLocation(ToolPathIndex point_index, const Vector3D& location);
 
-    /// @brief Finalize initialization (update location for last chunk of path points after last change + optimize m_data memory).
+    /// @brief Finalize initialization (optimize memory of location runs and m_data).
     void finalizeInitialization();
 
+    /// @brief Compress locations with quantized delta codec, every coordinate is kept within tolerance.
+    /// Compressed chunk is decoded back when its locations are modified, compress again after bulk updates.
+    /// @param tolerance maximal coordinate error, must be positive.
+    void compressLocations(float tolerance);
+
+    /// @returns memory used by location runs of all chunks in bytes (shared runs are counted for each chunk).
+    size_t locationsMemoryUsage() const;
+
+    /// @returns memory used by data tensors elements in bytes.
+    size_t dataMemoryUsage() const { return m_data.memoryUsage(); }
+
     /// @brief Update comment for the given path point.
-    void setComment(int point_index, const std::string& comment_str);
+    void setComment(ToolPathIndex point_index, std::string_view comment_str);
 
     /// @brief Update data for the given path point.
-    void setData(int point_index, const Data3D& values);
+    void setData(ToolPathIndex point_index, const Data3D& values);
+
+    /// @brief Update data for the given path point, values are copied from dense tensor.
+    void setData(ToolPathIndex point_index, const Tensor3DView& values);
 
     /// @brief Get path point info.
-    /// @param point_index index in m_points.
+    /// @param point_index index of path point.
     /// @returns path point data.
-    ToolPathPointInfo getToolPathPointInfo(int point_index);
+    ToolPathPointInfo getToolPathPointInfo(ToolPathIndex point_index) const;
+
+    /// @brief Get view of path point data, allocation-free alternative to getToolPathPointInfo.
+    /// @param point_index index of path point.
+    /// @returns path point data view.
+    ToolPathPointView getToolPathPointView(ToolPathIndex point_index) const;
+
+    /// @brief Batch read of path points [first_point_index, last_point_index) into SoA buffers,
+    /// locations are expanded from runs chunk by chunk without per-point lookups.
+    /// Compressed run locations are decoded in structure-of-arrays form straight into the batch buffers.
+    void gather(ToolPathIndex first_point_index, ToolPathIndex last_point_index, const ToolPathPointBatch& batch) const;
+
+    /// @brief Batch read of arbitrary path points into SoA buffers, i-th point of the batch is point_indices[i].
+    /// Points are visited in path order (indices are sorted internally unless already sorted),
+    /// so each chunk is located and decoded once (compressed runs in structure-of-arrays form),
+    /// large batches are gathered in parallel.
+    void gather(const std::vector<ToolPathIndex>& point_indices, const ToolPathPointBatch& batch) const;
 
     /// @brief Utility to cleanup metadata for all path points.
     void cleanUpMetaData();
 
     /// @brief Insertion of new path point at current path position.
     void InsertPathPointAtCurrentPosition(const Vector3D& location,
-                                          std::optional<std::string> comment = std::nullopt,
-                                          std::optional<Data3D> data_3d = std::nullopt); 
-
-    /// @brief Utility to synchronize m_path and m_point_indices_map after
-    /// path modifications (insertion/deletion of path points).
-    void updatePointIndices();
-
-    /// @brief utility to set m_current_position to the beginning of m_path.
+                                          std::optional<std::string_view> comment = std::nullopt,
+                                          const std::optional<Data3D>& data_3d = std::nullopt);
+
+    /// @brief Bulk insertion of new path points in one linear pass over the path.
+    /// @param insertions new path points, sorted or unsorted by point_index. Points with equal
+    /// point_index are inserted in the order they are given.
+    /// @note Resets current path position.
+    void insertPoints(const std::vector<ToolPathPointInsertion>& insertions);
+
+    /// @brief STL-style iteration over path points.
+    ToolPathConstIterator begin() const { return ToolPathConstIterator(this, 0); }
+    ToolPathConstIterator end() const { return ToolPathConstIterator(this, numPoints()); }
+    ToolPathConstIterator cbegin() const { return begin(); }
+    ToolPathConstIterator cend() const { return end(); }
+    ToolPathIterator begin() { return ToolPathIterator(this, 0); }
+    ToolPathIterator end() { return ToolPathIterator(this, numPoints()); }
+
+    /// @returns range of all path points, Attributes policy selects attributes read by its iterators.
+    template <typename Attributes = ToolPathAllAttributes>
+    BasicToolPathRange<Attributes> range() const { return BasicToolPathRange<Attributes>(*this, 0, numPoints()); }
+
+    /// @returns range of path points [first_point_index, last_point_index).
+    template <typename Attributes = ToolPathAllAttributes>
+    BasicToolPathRange<Attributes> range(ToolPathIndex first_point_index, ToolPathIndex last_point_index) const {
+      return BasicToolPathRange<Attributes>(*this, first_point_index, last_point_index);
+    }
+
+    /// @brief utility to set current position to the beginning of the path.
     void getFirst();
 
-    /// @brief utility to increment m_current_position to the next position in m_path.
+    /// @brief utility to increment current position to the next path point.
     /// @returns false if current position is at the end of the list already.
     bool getNext();
 
     /// @brief utility to append other_path to the end of the given one.
     /// @note: This procedure invalidates content of the other_path.
     void append(ToolPath& other_path);
+    void append(ToolPath&& other_path) { append(other_path); }
 
     /// @brief utility to clear all the data in ToolPath.
     void clear();
 
     /// @brief insertion of other tool path at given index.
     /// @note: This procedure invalidates content of the other_path.
-    void insert(int point_index, ToolPath& other_path);
+    void insert(ToolPathIndex point_index, ToolPath& other_path);
+    void insert(ToolPathIndex point_index, ToolPath&& other_path) { insert(point_index, other_path); }
+
+    /// @brief Erase given path point.
+    void erase(ToolPathIndex point_index) { erase(point_index, point_index + 1); }
+
+    /// @brief Erase path points [first_point_index, last_point_index), O(n_chunks) plus runs and metadata
+    /// of the two boundary chunks: chunks inside the range are dropped whole.
+    /// Following points keep their locations. Comments and data of erased points stay in the pools
+    /// until compact().
+    /// @note Resets current path position.
+    void erase(ToolPathIndex first_point_index, ToolPathIndex last_point_index);
+
+    /// @brief Compact storage after erasures: comments and data no longer referenced by path points
+    /// are dropped from the pools and adjacent chunks which fit kChunkSize together are merged.
+    /// @note Resets current path position.
+    void compact();
   
   private:
-    /// @brief Actual path - sequence of points.
-    std::list<ToolPathPoint> m_path;
+    /// @brief Maximal chunk size, chunk is split in halves when it grows beyond it.
+    static constexpr int kMaxChunkSize = 8192;
+
+    /// @brief Chunk size used when path is created or chunks are re-split.
+    static constexpr int kChunkSize = kMaxChunkSize / 2;
+
+    /// @brief Move data and comments of other_path into the given one, O(n_chunks) of other_path.
+    /// Metadata indices of other_path chunks are shifted through chunk base offsets.
+    void spliceMetaData(ToolPath& other_path);
 
-    /// @brief current position in the path.
-    std::list<ToolPathPoint>::iterator m_current_position;
+    /// @returns location of path point at given chunk and offset, O(log n_runs) typically,
+    /// std::nullopt if no location was set before the point.
+    /// @note Walks back to previous chunks if the chunk has no run before offset.
+    std::optional<Vector3D> findLocation(int chunk_index, int offset) const;
 
-    /// @brief flag indicating that m_current_position is set to something.
+    /// @returns view of path point at given chunk and offset.
+    ToolPathPointView getPointViewAt(int chunk_index, int offset) const;
+
+    /// @brief Move position (chunk index and offset) to the next point, skipping empty chunks.
+    /// Position after the last point is (number of chunks, 0).
+    void nextPosition(int& chunk_index, int& offset) const;
+
+    /// @brief Move position (chunk index and offset) to the previous point, skipping empty chunks.
+    void prevPosition(int& chunk_index, int& offset) const;
+
+    /// @returns position (chunk index and offset) of given path point, (number of chunks, 0) for numPoints().
+    int findPosition(ToolPathIndex point_index, int& offset) const;
+
+    /// @brief Split chunk at given offset into two chunks, rebuilds m_chunk_index.
+    void splitChunk(int chunk_index, int offset);
+
+    /// @brief Actual path - sequence of contiguous chunks of points.
+    std::vector<ToolPathChunk> m_chunks;
+
+    /// @brief Index to get chunk and offset in chunk by point index.
+    ToolPathChunkIndex m_chunk_index;
+
+    /// @brief current position in the path: chunk index and offset in chunk.
+    int m_current_chunk{0};
+    int m_current_offset{0};
+
+    /// @brief flag indicating that current position is set to something.
     bool m_current_position_set{false};
 
-    /// @brief vector to get ToolPathPoint by index.
-    std::vector<ToolPathPoint*> m_point_indices_map;
+    /// @brief Memory resource for chunks tables and data.
+    std::pmr::memory_resource* m_resource{std::pmr::get_default_resource()};
 
-    /// @brief flag indicating that m_points_indices_map container invalidated because of insertion/deletion of new path points.
-    bool m_point_indices_valid{true};
+    /// @brief comments pool, comment index of path point is id in the pool.
+    StringPool m_comments;
 
-    /// @brief Locations vector.
-    std::vector<Vector3D> m_locations;
+    /// @brief data arena, data index of path point is tensor id in the arena.
+    TensorArena m_data;
 
-    /// @brief comments set.
-    std::set<std::string> m_comments;
+    /// @brief Attached mutation journal, nullptr if none. Journal is not copied with the path.
+    ToolPathJournal* m_journal{nullptr};
 
-    /// @brief data vector.
-    std::vector<Data3D> m_data;
+    template <typename Attributes>
+    friend class BasicToolPathConstIterator;
+    friend class ToolPathIterator;
+    friend class ToolPathPointRef;
+    friend class ToolPathBuilder;
+    friend class ToolPathSnapshot;
+    friend class ToolPathSpatialIndex;
+    friend class ToolPathJournal;
 };
+
+extern template class BasicToolPathConstIterator<ToolPathLocationsOnly>;
+extern template class BasicToolPathConstIterator<ToolPathWithComments>;
+extern template class BasicToolPathConstIterator<ToolPathWithData>;
+extern template class BasicToolPathConstIterator<ToolPathAllAttributes>;
+extern template class BasicToolPathRange<ToolPathLocationsOnly>;
+extern template class BasicToolPathRange<ToolPathWithComments>;
+extern template class BasicToolPathRange<ToolPathWithData>;
+extern template class BasicToolPathRange<ToolPathAllAttributes>;
   
-} // namespace computational_geometry
+} // namespace computational_geometry
\ No newline at end of file
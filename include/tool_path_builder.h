@@ -0,0 +1,69 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+#include <tool_path.h>
+
+namespace computational_geometry {
+
+/// Append-only streaming builder of ToolPath.
+/// Path points, location changes, comments and data are accepted strictly in path order
+/// with amortized O(1) cost, chunks are filled directly and sealed into ToolPath without second pass.
+class ToolPathBuilder {
+  public:
+    /// @param resource memory resource of the path being built.
+    explicit ToolPathBuilder(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : m_chunk(0, resource), m_resource(resource), m_data(resource) {}
+
+    /// @returns number of path points added so far.
+    ToolPathIndex numPoints() const { return m_chunk_index.numPoints() + m_chunk.numPoints(); }
+
+    /// @brief Add new path point with given location, the first point must be added this way.
+    void addPoint(const Vector3D& location);
+
+    /// @brief Add path points inheriting location of the last added point.
+    void addPoints(ToolPathIndex n_points);
+
+    /// @brief Set comment of the last added path point.
+    void setComment(std::string_view comment_str);
+
+    /// @brief Set data of the last added path point.
+    void setData(const Data3D& values);
+
+    /// @brief Set data of the last added path point.
+    void setData(const Tensor3DView& values);
+
+    /// @brief Seal added path points into ToolPath, builder is reset to empty state.
+    ToolPath build();
+
+  private:
+    /// @brief Move filled current chunk to m_chunks and start new one.
+    void closeChunk();
+
+    /// @returns metadata of the last added path point, adds empty one if point has no metadata.
+    ToolPathPointMetaData& getLastMetaData();
+
+    /// @brief Chunk being filled, it is moved to m_chunks when it reaches ToolPath::kChunkSize.
+    ToolPathChunk m_chunk;
+
+    /// @brief Filled chunks.
+    std::vector<ToolPathChunk> m_chunks;
+
+    /// @brief Index over filled chunks, grows with m_chunks.
+    ToolPathChunkIndex m_chunk_index;
+
+    /// @brief Location of the last added path point.
+    Vector3D m_last_location{0., 0., 0.};
+
+    /// @brief Memory resource of the path being built.
+    std::pmr::memory_resource* m_resource;
+
+    /// @brief comments pool of the path being built.
+    StringPool m_comments;
+
+    /// @brief data arena of the path being built.
+    TensorArena m_data;
+};
+
+} // namespace computational_geometry
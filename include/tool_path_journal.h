@@ -0,0 +1,166 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <tool_path.h>
+
+namespace computational_geometry {
+
+/// Append-only write-ahead journal of ToolPath mutations for incremental persistence.
+/// Path is persisted as snapshot file (see ToolPathSnapshot) plus journal file of mutations made after it.
+/// Attached journal records every mutation of the path before it is applied, record holds arguments
+/// of the mutation only, so persistence cost is proportional to edit size: O(1) for setLocation(),
+/// setComment(), setData() and point insertions, size of inserted path for append() and insert().
+/// checkpoint() folds the journal into new snapshot and starts empty journal, it is done automatically
+/// when journal grows beyond given size. Checkpoints are crash-safe: snapshot and journal carry generation
+/// number and journal is replayed only onto snapshot of its generation.
+/// @note finalizeInitialization(), compact() and position changes do not change path contents and are not
+/// recorded. compressLocations() depends on chunk layout of the path, it is followed by checkpoint.
+/// @note Records are written to the file on each mutation (they survive process crash), sync() makes them
+/// durable on storage.
+class ToolPathJournal {
+  public:
+    /// @brief Attach journal to the path. Path must hold state persisted by the files (e.g. returned by
+    /// recover()), if files do not exist or journal is stale the path is checkpointed first.
+    /// @param checkpoint_size journal size in bytes which triggers automatic checkpoint, 0 to disable.
+    /// @throws std::runtime_error if files can not be read or written.
+    /// @note Path must outlive the journal, only one journal may be attached to the path.
+    ToolPathJournal(ToolPath& tool_path, const std::string& snapshot_file_name, const std::string& journal_file_name,
+                    size_t checkpoint_size = 0);
+    ToolPathJournal(const ToolPathJournal&) = delete;
+    ToolPathJournal& operator=(const ToolPathJournal&) = delete;
+
+    /// @brief Detach journal from the path, records written so far are kept.
+    ~ToolPathJournal();
+
+    /// @brief Load path persisted by snapshot and journal files: snapshot is loaded and journal records of
+    /// its generation are replayed onto it. Incomplete record at the end of journal (interrupted write) is ignored.
+    /// @param resource memory resource of the new path.
+    /// @returns empty path if neither file exists.
+    /// @throws std::runtime_error if files can not be read or they are corrupted.
+    static ToolPath recover(const std::string& snapshot_file_name, const std::string& journal_file_name,
+                            std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    /// @brief Save path to new snapshot and start empty journal, O(path size).
+    /// @throws std::runtime_error if files can not be written.
+    void checkpoint();
+
+    /// @brief Flush written records to storage.
+    /// @throws std::runtime_error on write error.
+    void sync();
+
+    /// @returns size of journal file in bytes.
+    size_t journalSize() const { return m_journal_size; }
+
+    /// @returns generation of the last checkpoint.
+    uint64_t generation() const { return m_generation; }
+
+  private:
+    /// Types of journal records.
+    enum class RecordType : uint32_t {
+      kSetLocation = 1,
+      kSetComment,
+      kSetData,
+      kInsertPoint,
+      kInsertPoints,
+      kAppend,
+      kInsert,
+      kErase,
+      kCleanUpMetaData,
+      kClear
+    };
+
+    /// Record header, payload follows it. Records and all payload fields are 4-byte aligned.
+    /// Point indices are 64-bit regardless of ToolPathIndex width.
+    struct RecordHeader {
+      uint32_t type;
+      uint32_t payload_size;
+      uint32_t checksum;
+    };
+
+    /// Journal file header.
+    struct FileHeader {
+      char magic[8];
+      uint32_t version;
+      uint32_t header_size;
+      uint64_t generation;
+    };
+
+    /// @brief Journal format version, incremented on any layout change.
+    static constexpr uint32_t kVersion = 2;
+
+    /// Bounds-checked reader of record payload.
+    class PayloadReader;
+
+    /// @brief Record appenders, called by ToolPath before mutation is applied.
+    void recordSetLocation(ToolPathIndex point_index, const Vector3D& location);
+    void recordSetComment(ToolPathIndex point_index, std::string_view comment_str);
+    void recordSetData(ToolPathIndex point_index, const Data3D& values);
+    void recordSetData(ToolPathIndex point_index, const Tensor3DView& values);
+    void recordInsertPoint(ToolPathIndex point_index, const Vector3D& location,
+                           const std::optional<std::string_view>& comment, const std::optional<Data3D>& data_3d);
+    void recordInsertPoints(const std::vector<ToolPathPointInsertion>& insertions);
+    void recordAppend(const ToolPath& other_path);
+    void recordInsert(ToolPathIndex point_index, const ToolPath& other_path);
+    void recordErase(ToolPathIndex first_point_index, ToolPathIndex last_point_index);
+    void recordCleanUpMetaData();
+    void recordClear();
+
+    /// @brief Start record of given type in m_record, checkpoint first if journal is too big.
+    void beginRecord(RecordType type);
+
+    /// @brief Write record collected in m_record to the journal.
+    void endRecord();
+
+    /// @brief Write new journal file with header only, replaces existing one.
+    void resetJournal();
+
+    /// @returns checksum of record header fields and payload.
+    static uint32_t checksum(uint32_t type, const char* payload, uint32_t payload_size);
+
+    /// @brief Call function(type, payload, payload_size) for each complete record of the journal file content.
+    /// @returns size of the complete records prefix.
+    template <typename Function>
+    static size_t forEachRecord(const std::vector<char>& content, Function function);
+
+    /// @brief Append path contents to the record: location runs and metadata with comment and data values.
+    static void writePath(std::vector<char>& record, const ToolPath& tool_path);
+
+    /// @returns path read from the record.
+    static ToolPath readPath(PayloadReader& reader, std::pmr::memory_resource* resource);
+
+    /// @brief Apply record to the path.
+    /// @throws std::runtime_error if record is malformed.
+    static void replay(ToolPath& tool_path, RecordType type, const char* payload, uint32_t payload_size);
+
+    /// @brief Path being journaled.
+    ToolPath* m_tool_path;
+
+    std::string m_snapshot_file_name;
+    std::string m_journal_file_name;
+
+    /// @brief Journal size which triggers checkpoint, 0 if disabled.
+    size_t m_checkpoint_size;
+
+    /// @brief Descriptor of journal file opened for appending.
+    int m_fd{-1};
+
+    /// @brief Current size of journal file.
+    size_t m_journal_size{0};
+
+    /// @brief Generation of the last checkpoint.
+    uint64_t m_generation{0};
+
+    /// @brief Buffer of the record being written.
+    std::vector<char> m_record;
+
+    friend class ToolPath;
+    friend class ToolPathPointRef;
+};
+
+} // namespace computational_geometry
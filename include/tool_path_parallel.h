@@ -0,0 +1,87 @@
+#pragma once
+
+#include <omp.h>
+#include <functional>
+#include <vector>
+
+#include <tool_path.h>
+
+namespace computational_geometry {
+
+/// Parallel bulk operations over path points of ToolPath (OpenMP).
+/// Range of points is split into balanced sub-ranges, a few per thread for load balancing,
+/// each sub-range is traversed with its own iterator. Views passed to functions have attributes
+/// selected by attribute policy of the range (see ToolPathLocationsOnly), all attributes by default.
+
+/// @returns number of sub-ranges parallel operations split path points into.
+inline int numParallelParts() { return 4 * omp_get_max_threads(); }
+
+/// @brief Apply function(const ToolPathPointView&) to all path points of the range in parallel.
+/// @note function is called concurrently, in unspecified order.
+template <typename Attributes, typename Function>
+void parallelForEach(const BasicToolPathRange<Attributes>& range, Function function) {
+  const auto parts = range.split(numParallelParts());
+  int n_parts = parts.size();
+  #pragma omp parallel for schedule(dynamic)
+  for (int i = 0; i < n_parts; i++) {
+    for (const auto& point_view : parts[i]) {
+      function(point_view);
+    }
+  }
+}
+
+/// @brief Transform all path points of the range with transform(const ToolPathPointView&) and
+/// reduce results with reduce(T, T) in parallel, reduce must be associative.
+/// @returns init reduced with all transformed path points.
+template <typename Attributes, typename T, typename ReduceFunction, typename TransformFunction>
+T parallelTransformReduce(const BasicToolPathRange<Attributes>& range, T init, ReduceFunction reduce,
+                          TransformFunction transform) {
+  const auto parts = range.split(numParallelParts());
+  int n_parts = parts.size();
+  std::vector<T> part_results(n_parts, init);
+  #pragma omp parallel for schedule(dynamic)
+  for (int i = 0; i < n_parts; i++) {
+    // Sub-ranges are never empty, partial result starts from the first point of sub-range.
+    auto iter = parts[i].begin();
+    const auto end = parts[i].end();
+    T result = transform(*iter);
+    for (++iter; iter != end; ++iter) {
+      result = reduce(result, transform(*iter));
+    }
+    part_results[i] = result;
+  }
+
+  // Partial results are reduced in order of sub-ranges.
+  for (const auto& part_result : part_results) {
+    init = reduce(init, part_result);
+  }
+  return init;
+}
+
+/// @returns number of path points of the range satisfying predicate(const ToolPathPointView&), computed in parallel.
+template <typename Attributes, typename Predicate>
+ToolPathIndex parallelCountIf(const BasicToolPathRange<Attributes>& range, Predicate predicate) {
+  return parallelTransformReduce(range, ToolPathIndex(0), std::plus<ToolPathIndex>(),
+                                 [&predicate](const ToolPathPointView& point_view) -> ToolPathIndex {
+                                   return predicate(point_view) ? 1 : 0;
+                                 });
+}
+
+/// @brief Overloads for all path points of ToolPath, attribute policy may be given explicitly,
+/// e.g. parallelCountIf<ToolPathWithComments>(tool_path, predicate).
+template <typename Attributes = ToolPathAllAttributes, typename Function>
+void parallelForEach(const ToolPath& tool_path, Function function) {
+  parallelForEach(tool_path.range<Attributes>(), function);
+}
+
+template <typename Attributes = ToolPathAllAttributes, typename T, typename ReduceFunction, typename TransformFunction>
+T parallelTransformReduce(const ToolPath& tool_path, T init, ReduceFunction reduce, TransformFunction transform) {
+  return parallelTransformReduce(tool_path.range<Attributes>(), init, reduce, transform);
+}
+
+template <typename Attributes = ToolPathAllAttributes, typename Predicate>
+ToolPathIndex parallelCountIf(const ToolPath& tool_path, Predicate predicate) {
+  return parallelCountIf(tool_path.range<Attributes>(), predicate);
+}
+
+} // namespace computational_geometry
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <tool_path.h>
+
+namespace computational_geometry {
+
+/// Read-only memory-mapped binary snapshot of ToolPath.
+/// File consists of fixed header and 64-byte aligned sections of plain arrays:
+/// chunk records, location runs, metadata, comments pool and data values. Sections are
+/// used in place through the mapping, path points are queried without parsing the file.
+class ToolPathSnapshot {
+  public:
+    /// @brief Save tool path to binary snapshot file, sections are written with bulk writes.
+    /// @param generation number stored in the header, identifies the snapshot for mutation journals.
+    /// @throws std::runtime_error if file can not be written.
+    static void save(const ToolPath& tool_path, const std::string& file_name, uint64_t generation = 0);
+
+    /// @brief Map snapshot file into memory.
+    /// @throws std::runtime_error if file can not be mapped, it is not a valid snapshot (including
+    /// corrupted records) or its number of points exceeds ToolPathIndex range.
+    explicit ToolPathSnapshot(const std::string& file_name);
+    ToolPathSnapshot(const ToolPathSnapshot&) = delete;
+    ToolPathSnapshot& operator=(const ToolPathSnapshot&) = delete;
+    ~ToolPathSnapshot();
+
+    /// @returns number of path points.
+    ToolPathIndex numPoints() const { return static_cast<ToolPathIndex>(m_header->n_points); }
+
+    /// @returns number of comments in the comments pool.
+    int numComments() const { return m_header->n_comments; }
+
+    /// @returns number of tensors in the data pool.
+    int numData() const { return m_header->n_tensors; }
+
+    /// @returns generation number given on save.
+    uint64_t generation() const { return m_header->generation; }
+
+    /// @returns comment with given id, view points into the mapping.
+    std::string_view getComment(int comment_index) const;
+
+    /// @returns tensor with given id, view points into the mapping.
+    Tensor3DView getData(int data_index) const;
+
+    /// @brief Get view of path point data, O(log n_chunks + log n_runs).
+    /// @note Views are valid while the snapshot is alive.
+    ToolPathPointView getToolPathPointView(ToolPathIndex point_index) const;
+
+    /// @brief Load snapshot into new ToolPath, chunk tables are copied from the mapping in bulk.
+    /// @param resource memory resource of the new path.
+    ToolPath toToolPath(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const;
+
+  private:
+    /// @brief Snapshot format version, incremented on any layout change.
+    static constexpr uint32_t kVersion = 2;
+
+    /// @brief Alignment of sections in the file.
+    static constexpr uint64_t kSectionAlignment = 64;
+
+    /// File header.
+    struct Header {
+      char magic[8];
+      uint32_t version;
+      uint32_t header_size;
+      uint64_t file_size;
+      uint64_t generation;
+
+      uint64_t n_points;
+      uint64_t n_chunks;
+      uint64_t n_runs;
+      uint64_t n_metadata;
+      uint64_t n_comments;
+      uint64_t n_comment_chars;
+      uint64_t n_tensors;
+      uint64_t n_tensor_values;
+
+      uint64_t chunks_offset;
+      uint64_t run_starts_offset;
+      uint64_t locations_offset;
+      uint64_t metadata_offsets_offset;
+      uint64_t metadata_offset;
+      uint64_t comment_spans_offset;
+      uint64_t comment_chars_offset;
+      uint64_t tensors_offset;
+      uint64_t tensor_values_offset;
+    };
+
+    /// Chunk record, runs and metadata of the chunk are contiguous ranges of the sections.
+    /// Every non-empty chunk starts with a run, no walk back to previous chunks is needed.
+    struct ChunkRecord {
+      uint64_t first_point;
+      uint64_t first_run;
+      uint64_t first_metadata;
+      uint32_t n_points;
+      uint32_t n_runs;
+      uint32_t n_metadata;
+      uint32_t flags;
+    };
+
+    /// @brief Chunk record flag: the first run is added on save, points of the chunk inherit its location
+    /// from previous chunks in the path (so that insertions before them update it too).
+    static constexpr uint32_t kEntryRunFlag = 1;
+
+    /// Metadata record, indices are global ids in comments and data sections, -1 if not set.
+    struct MetaDataRecord {
+      int32_t comment_index;
+      int32_t data_index;
+    };
+
+    /// Position of comment in comment chars section.
+    struct CommentRecord {
+      uint64_t offset;
+      uint64_t length;
+    };
+
+    /// Position and sizes of tensor in tensor values section.
+    struct TensorRecord {
+      uint64_t offset;
+      int32_t dims[3];
+      int32_t reserved;
+    };
+
+    /// @returns pointer to section at given offset in the mapping.
+    template <typename T>
+    const T* section(uint64_t offset) const { return reinterpret_cast<const T*>(m_mapping + offset); }
+
+    /// @brief Validate header, sections bounds and records: chunk ranges, run starts and metadata offsets,
+    /// comment and data ids, comment and tensor spans. O(chunks + runs + metadata + comments + tensors),
+    /// location, comment chars and tensor values sections are not read.
+    /// @throws std::runtime_error if snapshot is not valid.
+    void validate(const std::string& file_name) const;
+
+    /// @brief Mapped file.
+    const char* m_mapping{nullptr};
+    size_t m_mapping_size{0};
+
+    /// @brief Header at the beginning of the mapping.
+    const Header* m_header{nullptr};
+
+    /// @brief Sections in the mapping.
+    const ChunkRecord* m_chunks{nullptr};
+    const int32_t* m_run_starts{nullptr};
+    const Vector3D* m_locations{nullptr};
+    const int32_t* m_metadata_offsets{nullptr};
+    const MetaDataRecord* m_metadata{nullptr};
+    const CommentRecord* m_comments{nullptr};
+    const char* m_comment_chars{nullptr};
+    const TensorRecord* m_tensors{nullptr};
+    const float* m_tensor_values{nullptr};
+};
+
+} // namespace computational_geometry
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include <tool_path.h>
+
+namespace computational_geometry {
+
+/// Axis-aligned bounding box, empty box has min > max.
+struct BoundingBox3D {
+  Vector3D min{std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity(),
+               std::numeric_limits<float>::infinity()};
+  Vector3D max{-std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(),
+               -std::numeric_limits<float>::infinity()};
+
+  bool empty() const { return min[0] > max[0]; }
+
+  void extend(const Vector3D& point) {
+    for (int axis = 0; axis < 3; axis++) {
+      min[axis] = std::min(min[axis], point[axis]);
+      max[axis] = std::max(max[axis], point[axis]);
+    }
+  }
+
+  void extend(const BoundingBox3D& box) {
+    for (int axis = 0; axis < 3; axis++) {
+      min[axis] = std::min(min[axis], box.min[axis]);
+      max[axis] = std::max(max[axis], box.max[axis]);
+    }
+  }
+
+  bool contains(const Vector3D& point) const {
+    return point[0] >= min[0] && point[0] <= max[0] && point[1] >= min[1] && point[1] <= max[1] &&
+           point[2] >= min[2] && point[2] <= max[2];
+  }
+
+  bool contains(const BoundingBox3D& box) const { return contains(box.min) && contains(box.max); }
+
+  bool intersects(const BoundingBox3D& box) const {
+    return box.min[0] <= max[0] && box.max[0] >= min[0] && box.min[1] <= max[1] && box.max[1] >= min[1] &&
+           box.min[2] <= max[2] && box.max[2] >= min[2];
+  }
+
+  /// @returns squared distance from point to the nearest point of the box, 0 if point is inside.
+  float distanceSquared(const Vector3D& point) const {
+    float result = 0.;
+    for (int axis = 0; axis < 3; axis++) {
+      float delta = std::max({min[axis] - point[axis], 0.f, point[axis] - max[axis]});
+      result += delta * delta;
+    }
+    return result;
+  }
+
+  /// @returns squared distance from point to the farthest corner of the box.
+  float maxDistanceSquared(const Vector3D& point) const {
+    float result = 0.;
+    for (int axis = 0; axis < 3; axis++) {
+      float delta = std::max(point[axis] - min[axis], max[axis] - point[axis]);
+      result += delta * delta;
+    }
+    return result;
+  }
+};
+
+/// Spatial index over path point locations of ToolPath: bounding volume hierarchy with chunk boxes in leaves.
+/// Queries descend to chunks whose boxes match the query and scan their location runs, so they cost
+/// O(log n_chunks) plus location runs of the matching chunks, subtrees inside the query are taken whole.
+/// Index keeps weak references to location runs of the chunks it was built from together with their versions,
+/// so that modified chunks are detected by their runs without sharing them (runs are neither copied on the next
+/// modification nor kept alive by the index), and update() after append(), insert() or other modifications
+/// recomputes boxes of modified chunks only.
+/// @note Path must outlive the index, queries on modified path require update() first.
+class ToolPathSpatialIndex {
+  public:
+    /// @brief Build index over all path points, O(n_runs).
+    explicit ToolPathSpatialIndex(const ToolPath& tool_path);
+
+    /// @brief Bring index up to date with the path, O(n_chunks) plus location runs of modified chunks.
+    void update();
+
+    /// @returns sorted disjoint ranges of path points with locations inside the box.
+    std::vector<ToolPathRange> findInBox(const BoundingBox3D& box) const;
+
+    /// @returns sorted disjoint ranges of path points with locations within radius from center.
+    std::vector<ToolPathRange> findInRadius(const Vector3D& center, float radius) const;
+
+    /// @returns index of the first path point nearest to location, -1 if path is empty.
+    ToolPathIndex findNearest(const Vector3D& location) const;
+
+  private:
+    /// Relation of tree node box to query region.
+    enum class NodeRelation { kOutside, kIntersects, kInside };
+
+    /// @brief Collect ranges of points matching the query, node_relation(box) classifies tree nodes,
+    /// location_matches(location) checks location runs of intersecting chunks.
+    template <typename NodeRelationFunction, typename LocationPredicate>
+    std::vector<ToolPathRange> findRanges(NodeRelationFunction node_relation, LocationPredicate location_matches) const;
+
+    /// @brief Call function(first_point_index, last_point_index, location) for each range of points
+    /// sharing location in the chunk, in path order.
+    template <typename Function>
+    void forEachLocationRange(int chunk_index, Function function) const;
+
+    /// @returns bounding box of run locations.
+    static BoundingBox3D runsBox(const ToolPathChunk::LocationRuns& runs);
+
+    const ToolPath* m_tool_path;
+
+    /// @brief Location runs each chunk box was computed from and their versions, empty if chunk has no runs.
+    std::vector<std::weak_ptr<const ToolPathChunk::LocationRuns>> m_chunk_runs;
+    std::vector<uint64_t> m_chunk_runs_versions;
+
+    /// @brief Bounding box of run locations of each chunk.
+    std::vector<BoundingBox3D> m_runs_boxes;
+
+    /// @brief Location inherited by points before the first run of each chunk.
+    std::vector<std::optional<Vector3D>> m_entry_locations;
+
+    /// @brief Index of the first path point of each chunk.
+    std::vector<ToolPathIndex> m_first_points;
+
+    /// @brief Number of leaves of the tree, power of two not less than number of chunks.
+    int m_n_leaves{1};
+
+    /// @brief Implicit binary tree of boxes: root is 1, children of node i are 2i and 2i+1,
+    /// leaf of chunk i is m_n_leaves + i.
+    std::vector<BoundingBox3D> m_tree;
+};
+
+} // namespace computational_geometry
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <tool_path.h>
+
+namespace computational_geometry {
+
+/// Multi-version concurrency control for ToolPath: single writer edits private working path and publishes
+/// immutable versions of it, any number of readers pin the latest published version and traverse it
+/// without locks while the writer goes on.
+/// Publishing copies working path in O(n_chunks): location runs, metadata, comments pool and data tensors
+/// are shared with published versions copy-on-write, so the writer never modifies memory readers see.
+/// The first edit of comments or data after publish() copies the comments pool or tensors table once.
+/// Replaced versions are retired and released by the writer once no reader holds them (deferred reclamation).
+/// @note Memory resource of the path must be thread-safe, versions are released concurrently with writer edits.
+class ToolPathVersions {
+  public:
+    /// @brief Publish copy of tool_path as the first version.
+    explicit ToolPathVersions(const ToolPath& tool_path);
+    ToolPathVersions(const ToolPathVersions&) = delete;
+    ToolPathVersions& operator=(const ToolPathVersions&) = delete;
+
+    /// @returns latest published version, it stays valid and unchanged while the reader holds it.
+    /// @note Thread-safe, may be called concurrently with publish().
+    std::shared_ptr<const ToolPath> snapshot() const { return std::atomic_load(&m_published); }
+
+    /// @returns number of versions published so far (the first one is 1).
+    /// @note Thread-safe.
+    uint64_t version() const { return m_version.load(std::memory_order_acquire); }
+
+    /// @returns working path of the writer, its modifications are invisible to readers until publish().
+    /// @note Only one thread may use working path and call publish() and reclaim().
+    ToolPath& writer() { return m_working; }
+
+    /// @brief Publish current state of working path as new version, O(n_chunks).
+    /// Retired versions without readers are released.
+    void publish();
+
+    /// @brief Release retired versions which are not held by readers anymore.
+    /// @returns number of retired versions still held by readers.
+    int reclaim();
+
+  private:
+    /// @brief Private path of the writer.
+    ToolPath m_working;
+
+    /// @brief Latest published version, accessed with atomic shared_ptr operations.
+    std::shared_ptr<const ToolPath> m_published;
+
+    /// @brief Replaced versions which may still be held by readers.
+    std::vector<std::shared_ptr<const ToolPath>> m_retired;
+
+    /// @brief Number of published versions.
+    std::atomic<uint64_t> m_version{0};
+};
+
+} // namespace computational_geometry
@@ -0,0 +1,149 @@
+#include <location_codec.h>
+
+#include <assert.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace computational_geometry {
+
+bool EncodedLocations::encode(const Vector3D* locations, int n_locations, float tolerance) {
+  assert(tolerance > 0.);
+  m_codes.clear();
+  m_checkpoints.clear();
+  m_escapes.clear();
+  if (n_locations == 0) {
+    return true;
+  }
+
+  // Quantization error is at most half of the step, but restored coordinates are also rounded to float.
+  if (encodeWithStep(locations, n_locations, 2. * tolerance, tolerance)) {
+    return true;
+  }
+
+  // Step is reduced by float spacing at the largest coordinate to keep sum of both errors within tolerance.
+  double max_coordinate = 0.;
+  for (int i = 0; i < n_locations; i++) {
+    for (int axis = 0; axis < 3; axis++) {
+      max_coordinate = std::max(max_coordinate, std::fabs(static_cast<double>(locations[i][axis])));
+    }
+  }
+  double half_spacing = std::ldexp(1., std::ilogb(max_coordinate + tolerance) - std::numeric_limits<float>::digits);
+  double step = 2. * (tolerance - half_spacing);
+  return step > 0. && encodeWithStep(locations, n_locations, step, tolerance);
+}
+
+bool EncodedLocations::encodeWithStep(const Vector3D* locations, int n_locations, double step, float tolerance) {
+  m_base = locations[0];
+  m_step = step;
+  m_codes.reserve(n_locations);
+  m_checkpoints.reserve((n_locations + kCheckpointStep - 1) / kCheckpointStep);
+
+  // Delta along single axis must fit upper bits of the code.
+  constexpr int64_t kMaxDelta = (int64_t{1} << (31 - kAxisBits)) - 1;
+  constexpr int64_t kMinDelta = -kMaxDelta - 1;
+
+  State previous{0, 0, 0};
+  for (int i = 0; i < n_locations; i++) {
+    State state;
+    for (int axis = 0; axis < 3; axis++) {
+      double value = std::round((static_cast<double>(locations[i][axis]) - m_base[axis]) / m_step);
+      if (!(std::fabs(value) <= std::numeric_limits<int32_t>::max()) ||
+          !(std::fabs(static_cast<double>(toCoordinate(static_cast<int32_t>(value), axis)) - locations[i][axis]) <=
+            tolerance)) {
+        m_codes.clear();
+        m_checkpoints.clear();
+        m_escapes.clear();
+        return false;
+      }
+      state[axis] = static_cast<int32_t>(value);
+    }
+
+    if (i % kCheckpointStep == 0) {
+      m_checkpoints.push_back(state);
+    }
+
+    int n_changed = 0;
+    int changed_axis = 0;
+    for (int axis = 0; axis < 3; axis++) {
+      if (state[axis] != previous[axis]) {
+        n_changed++;
+        changed_axis = axis;
+      }
+    }
+
+    int64_t delta = static_cast<int64_t>(state[changed_axis]) - previous[changed_axis];
+    if (n_changed <= 1 && delta >= kMinDelta && delta <= kMaxDelta) {
+      m_codes.push_back((static_cast<uint32_t>(delta) << kAxisBits) | changed_axis);
+    } else {
+      m_codes.push_back((static_cast<uint32_t>(m_escapes.size()) << kAxisBits) | kEscapeAxis);
+      m_escapes.push_back(state);
+    }
+    previous = state;
+  }
+
+  return true;
+}
+
+EncodedLocations::State EncodedLocations::stateAt(int index) const {
+  assert(index >= 0 && index < size());
+  int checkpoint = index / kCheckpointStep;
+  State state = m_checkpoints[checkpoint];
+  for (int i = checkpoint * kCheckpointStep + 1; i <= index; i++) {
+    advance(state, i);
+  }
+  return state;
+}
+
+void EncodedLocations::decode(int first, int count, float* x, float* y, float* z) const {
+  assert(first >= 0 && count >= 0 && first + count <= size());
+  if (count == 0) {
+    return;
+  }
+
+  // Codes are sequentially dependent, quantized coordinates of the block are expanded first...
+  int32_t offsets[3][kDecodeBlockSize];
+  float* coordinates[3] = {x, y, z};
+  State state = stateAt(first);
+  for (int block_first = 0; block_first < count; block_first += kDecodeBlockSize) {
+    int block_size = std::min(kDecodeBlockSize, count - block_first);
+    for (int i = 0; i < block_size; i++) {
+      if (block_first + i > 0) {
+        advance(state, first + block_first + i);
+      }
+      offsets[0][i] = state[0];
+      offsets[1][i] = state[1];
+      offsets[2][i] = state[2];
+    }
+
+    // ...and mapped to the grid around the base point in independent loops.
+    for (int axis = 0; axis < 3; axis++) {
+      const double base = m_base[axis];
+      const double step = m_step;
+      float* block_coordinates = coordinates[axis] + block_first;
+      for (int i = 0; i < block_size; i++) {
+        block_coordinates[i] = static_cast<float>(base + offsets[axis][i] * step);
+      }
+    }
+  }
+}
+
+void EncodedLocations::decode(int first, int count, Vector3D* locations) const {
+  assert(first >= 0 && count >= 0 && first + count <= size());
+  if (count == 0) {
+    return;
+  }
+
+  State state = stateAt(first);
+  locations[0] = toLocation(state);
+  for (int i = 1; i < count; i++) {
+    advance(state, first + i);
+    locations[i] = toLocation(state);
+  }
+}
+
+size_t EncodedLocations::memoryUsage() const {
+  return m_codes.capacity() * sizeof(uint32_t) + (m_checkpoints.capacity() + m_escapes.capacity()) * sizeof(State);
+}
+
+} // namespace computational_geometry
@@ -0,0 +1,135 @@
+#include <string_pool.h>
+
+#include <assert.h>
+#include <functional>
+#include <string>
+
+namespace computational_geometry {
+
+const StringPool::Content& StringPool::content() const {
+  static const Content empty_content;
+  return m_content ? *m_content : empty_content;
+}
+
+StringPool::Content& StringPool::mutableContent() {
+  if (!m_content) {
+    m_content = std::make_shared<Content>();
+  } else if (m_content.use_count() > 1) {
+    m_content = std::make_shared<Content>(*m_content);
+  }
+
+  return *m_content;
+}
+
+int StringPool::findSlot(std::string_view str, size_t hash) const {
+  const auto& slots = content().slots;
+  assert(!slots.empty());
+  size_t mask = slots.size() - 1;
+  for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+    int id = slots[slot];
+    if (id < 0 || (content().hashes[id] == hash && get(id) == str)) {
+      return slot;
+    }
+  }
+}
+
+void StringPool::rehash(int n_slots) {
+  auto& content = mutableContent();
+  std::vector<int> old_slots(n_slots, -1);
+  old_slots.swap(content.slots);
+  size_t mask = n_slots - 1;
+  for (int id : old_slots) {
+    if (id < 0) {
+      continue;
+    }
+
+    size_t slot = content.hashes[id] & mask;
+    while (content.slots[slot] >= 0) {
+      slot = (slot + 1) & mask;
+    }
+    content.slots[slot] = id;
+  }
+}
+
+int StringPool::intern(std::string_view str) {
+  // Strings which are already in the pool are found without modification (and copy) of shared content.
+  size_t hash = std::hash<std::string_view>()(str);
+  int slot = -1;
+  if (!content().slots.empty()) {
+    slot = findSlot(str, hash);
+    if (content().slots[slot] >= 0) {
+      return content().slots[slot];
+    }
+  }
+
+  // New string - append it to the arena. It may be a view of the arena, which is invalidated by growth.
+  auto& content = mutableContent();
+  if (!content.arena.empty()) {
+    std::less_equal<const char*> less_equal;
+    if (less_equal(content.arena.data(), str.data()) &&
+        less_equal(str.data(), content.arena.data() + content.arena.size() - 1)) {
+      std::string copy(str);
+      return intern(copy);
+    }
+  }
+
+  // Keep load factor below 1/2 (counting aliases as well, for simplicity).
+  int n_strings = size();
+  if (2 * (n_strings + 1) > static_cast<int>(content.slots.size())) {
+    rehash(content.slots.empty() ? 16 : 2 * content.slots.size());
+    slot = findSlot(str, hash);
+  }
+
+  Span span;
+  span.offset = content.arena.size();
+  span.length = str.size();
+  content.arena.insert(content.arena.end(), str.begin(), str.end());
+  content.spans.push_back(span);
+  content.hashes.push_back(hash);
+  content.slots[slot] = n_strings;
+  return n_strings;
+}
+
+int StringPool::find(std::string_view str) const {
+  if (content().slots.empty()) {
+    return -1;
+  }
+
+  return content().slots[findSlot(str, std::hash<std::string_view>()(str))];
+}
+
+std::string_view StringPool::get(int id) const {
+  assert(id >= 0);
+  assert(id < size());
+  const auto& span = content().spans[id];
+  return std::string_view(content().arena.data() + span.offset, span.length);
+}
+
+int StringPool::add(std::string_view str) {
+  int new_id = size();
+  int id = intern(str);
+  if (id != new_id) {
+    // String was already in the pool - add alias id.
+    auto& content = mutableContent();
+    content.spans.push_back(content.spans[id]);
+    content.hashes.push_back(content.hashes[id]);
+  }
+
+  return new_id;
+}
+
+int StringPool::append(const StringPool& other) {
+  int id_offset = size();
+  int n_other_strings = other.size();
+  for (int other_id = 0; other_id < n_other_strings; other_id++) {
+    add(other.get(other_id));
+  }
+
+  return id_offset;
+}
+
+void StringPool::clear() {
+  m_content.reset();
+}
+
+} // namespace computational_geometry
@@ -0,0 +1,271 @@
+#include <tensor_arena.h>
+
+#include <assert.h>
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <string_view>
+
+namespace computational_geometry {
+
+Data3D Tensor3DView::toData3D() const {
+  Data3D result(m_dims[0], std::vector<std::vector<float>>(m_dims[1], std::vector<float>(m_dims[2])));
+  const float* values = m_values;
+  for (auto& data_2d : result) {
+    for (auto& data_1d : data_2d) {
+      data_1d.assign(values, values + m_dims[2]);
+      values += m_dims[2];
+    }
+  }
+
+  return result;
+}
+
+const TensorArena::Table& TensorArena::table() const {
+  static const Table empty_table;
+  return m_table ? *m_table : empty_table;
+}
+
+TensorArena::Table& TensorArena::mutableTable() {
+  if (!m_table) {
+    m_table = std::make_shared<Table>();
+  } else if (m_table.use_count() > 1) {
+    m_table = std::make_shared<Table>(*m_table);
+  }
+
+  return *m_table;
+}
+
+float* TensorArena::allocate(const std::array<int, 3>& dims) {
+  size_t n_values = static_cast<size_t>(dims[0]) * dims[1] * dims[2];
+  if (m_blocks.empty() || m_blocks.back().use_count() > 1 ||
+      (!m_blocks.back()->empty() && m_blocks.back()->size() + n_values > kBlockSize)) {
+    // Block vector gets the allocator (and memory resource) through uses-allocator construction.
+    m_blocks.push_back(std::allocate_shared<std::pmr::vector<float>>(
+        std::pmr::polymorphic_allocator<std::pmr::vector<float>>(m_resource)));
+  }
+
+  auto& block = *m_blocks.back();
+  Entry entry;
+  entry.block = m_blocks.size() - 1;
+  entry.offset = block.size();
+  entry.dims = dims;
+  block.resize(block.size() + n_values);
+  mutableTable().entries.push_back(entry);
+  return block.data() + entry.offset;
+}
+
+int TensorArena::add(const Data3D& data) {
+  std::array<int, 3> dims;
+  dims[0] = data.size();
+  dims[1] = data.empty() ? 0 : data[0].size();
+  dims[2] = (data.empty() || data[0].empty()) ? 0 : data[0][0].size();
+  float* values = allocate(dims);
+  for (const auto& data_2d : data) {
+    assert(static_cast<int>(data_2d.size()) == dims[1]);
+    for (const auto& data_1d : data_2d) {
+      assert(static_cast<int>(data_1d.size()) == dims[2]);
+      values = std::copy(data_1d.begin(), data_1d.end(), values);
+    }
+  }
+
+  return deduplicateLast();
+}
+
+int TensorArena::add(const Tensor3DView& tensor) {
+  // Tensor may be a view of the last block, growth of the block would invalidate it.
+  if (!m_blocks.empty() && !m_blocks.back()->empty()) {
+    const auto& block = *m_blocks.back();
+    std::less_equal<const float*> less_equal;
+    if (less_equal(block.data(), tensor.data()) && less_equal(tensor.data(), block.data() + block.size() - 1)) {
+      std::vector<float> copy(tensor.data(), tensor.data() + tensor.numElements());
+      return add(Tensor3DView(copy.data(), tensor.dims()));
+    }
+  }
+
+  float* values = allocate(tensor.dims());
+  std::copy(tensor.data(), tensor.data() + tensor.numElements(), values);
+  return deduplicateLast();
+}
+
+size_t TensorArena::hashTensor(const Tensor3DView& tensor) {
+  std::string_view bytes(reinterpret_cast<const char*>(tensor.data()), tensor.numElements() * sizeof(float));
+  size_t hash = std::hash<std::string_view>()(bytes);
+  for (int dim : tensor.dims()) {
+    hash ^= std::hash<int>()(dim) + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+  }
+  return hash;
+}
+
+int TensorArena::findSlot(const Tensor3DView& tensor, size_t hash) const {
+  const auto& table = this->table();
+  assert(!table.slots.empty());
+  size_t mask = table.slots.size() - 1;
+  for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+    int id = table.slots[slot];
+    if (id < 0) {
+      return slot;
+    }
+    if (table.hashes[id] == hash) {
+      const auto other = get(id);
+      if (other.dims() == tensor.dims() && (tensor.numElements() == 0 ||
+          std::memcmp(other.data(), tensor.data(), tensor.numElements() * sizeof(float)) == 0)) {
+        return slot;
+      }
+    }
+  }
+}
+
+void TensorArena::rehash(int n_slots) {
+  auto& table = mutableTable();
+  std::vector<int> old_slots(n_slots, -1);
+  old_slots.swap(table.slots);
+  size_t mask = n_slots - 1;
+  for (int id : old_slots) {
+    if (id < 0) {
+      continue;
+    }
+
+    size_t slot = table.hashes[id] & mask;
+    while (table.slots[slot] >= 0) {
+      slot = (slot + 1) & mask;
+    }
+    table.slots[slot] = id;
+  }
+}
+
+void TensorArena::hashEntries(int end_id) {
+  auto& table = mutableTable();
+
+  // Keep load factor below 1/2 (counting repeated tensors as well, for simplicity).
+  if (2 * end_id > static_cast<int>(table.slots.size())) {
+    int n_slots = table.slots.empty() ? 16 : table.slots.size();
+    while (2 * end_id > n_slots) {
+      n_slots *= 2;
+    }
+    rehash(n_slots);
+  }
+
+  table.hashes.resize(end_id);
+  for (int id = table.n_hashed; id < end_id; id++) {
+    const auto tensor = get(id);
+    size_t hash = hashTensor(tensor);
+    table.hashes[id] = hash;
+    int slot = findSlot(tensor, hash);
+    if (table.slots[slot] < 0) {
+      table.slots[slot] = id;
+    }
+  }
+  table.n_hashed = end_id;
+}
+
+int TensorArena::deduplicateLast() {
+  int id = size() - 1;
+  hashEntries(id + 1);
+  auto& table = mutableTable();
+  int existing_id = table.slots[findSlot(get(id), table.hashes[id])];
+  if (existing_id != id) {
+    // Tensor is already in the arena - release new elements (they are at the end of the last block).
+    auto& entry = table.entries[id];
+    assert(entry.block == static_cast<int>(m_blocks.size()) - 1);
+    m_blocks[entry.block]->resize(entry.offset);
+    entry = table.entries[existing_id];
+  }
+
+  return id;
+}
+
+Tensor3DView TensorArena::get(int id) const {
+  assert(id >= 0);
+  assert(id < size());
+  const auto& entry = table().entries[id];
+  return Tensor3DView(m_blocks[entry.block]->data() + entry.offset, entry.dims);
+}
+
+int TensorArena::append(TensorArena&& other) {
+  int id_offset = size();
+  int block_offset = m_blocks.size();
+  m_blocks.reserve(m_blocks.size() + other.m_blocks.size());
+  for (auto& block : other.m_blocks) {
+    m_blocks.push_back(std::move(block));
+  }
+  auto& entries = mutableTable().entries;
+  entries.reserve(entries.size() + other.size());
+  for (auto entry : other.table().entries) {
+    entry.block += block_offset;
+    entries.push_back(entry);
+  }
+  other.clear();
+
+  return id_offset;
+}
+
+std::vector<int> TensorArena::appendAll(const std::vector<TensorArena*>& others) {
+  // Prefix sums of blocks and tensors define where each arena lands.
+  int n_others = others.size();
+  std::vector<int> id_offsets(n_others + 1, size());
+  std::vector<int> block_offsets(n_others + 1, m_blocks.size());
+  for (int i = 0; i < n_others; i++) {
+    id_offsets[i + 1] = id_offsets[i] + others[i]->size();
+    block_offsets[i + 1] = block_offsets[i] + others[i]->m_blocks.size();
+  }
+  auto& entries = mutableTable().entries;
+  entries.resize(id_offsets[n_others]);
+  m_blocks.resize(block_offsets[n_others]);
+
+  #pragma omp parallel for schedule(dynamic)
+  for (int i = 0; i < n_others; i++) {
+    auto& other = *others[i];
+    int block_index = block_offsets[i];
+    for (auto& block : other.m_blocks) {
+      m_blocks[block_index] = std::move(block);
+      block_index++;
+    }
+    int id = id_offsets[i];
+    for (auto entry : other.table().entries) {
+      entry.block += block_offsets[i];
+      entries[id] = entry;
+      id++;
+    }
+  }
+
+  // Arenas are cleared sequentially since memory resources may not be thread-safe.
+  for (auto* other : others) {
+    other->clear();
+  }
+
+  id_offsets.pop_back();
+  return id_offsets;
+}
+
+void TensorArena::reserve(int n_tensors, int n_blocks) {
+  mutableTable().entries.reserve(n_tensors);
+  m_blocks.reserve(n_blocks);
+}
+
+void TensorArena::shrinkToFit() {
+  for (auto& block : m_blocks) {
+    if (block.use_count() == 1) {
+      block->shrink_to_fit();
+    }
+  }
+  m_blocks.shrink_to_fit();
+  if (m_table && m_table.use_count() == 1) {
+    m_table->entries.shrink_to_fit();
+  }
+}
+
+size_t TensorArena::memoryUsage() const {
+  size_t result = 0;
+  for (const auto& block : m_blocks) {
+    result += block->capacity() * sizeof(float);
+  }
+  return result;
+}
+
+void TensorArena::clear() {
+  std::vector<std::shared_ptr<std::pmr::vector<float>>>().swap(m_blocks);
+  m_table.reset();
+}
+
+} // namespace computational_geometry
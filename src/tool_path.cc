@@ -1,515 +1,1500 @@
 #include <tool_path.h>
 
+#include <tool_path_journal.h>
+
 #include <assert.h>
+#include <algorithm>
+#include <iterator>
+#include <numeric>
 
 namespace computational_geometry {
 
-void ToolPathPoint::setLocationIndex(int location_index) {
-  assert(location_index >= 0);
-  assert(location_index >= m_location_index);
-  m_location_index = location_index;
+namespace {
+
+/// @returns index of the first of sorted values starting from given index which is greater than value.
+/// Cursors of sorted batches usually advance by a few values, so they are probed linearly first.
+int advanceCursor(const std::pmr::vector<int>& values, int first, int value) {
+  int n_values = values.size();
+  for (int last = std::min(first + 8, n_values); first < last; first++) {
+    if (values[first] > value) {
+      return first;
+    }
+  }
+  return std::upper_bound(values.begin() + first, values.end(), value) - values.begin();
+}
+
+} // namespace
+
+std::shared_ptr<ToolPathChunk::LocationRuns> ToolPathChunk::makeRuns() const {
+  return std::allocate_shared<LocationRuns>(std::pmr::polymorphic_allocator<LocationRuns>(m_resource), m_resource);
+}
+
+std::shared_ptr<ToolPathChunk::MetaDataTable> ToolPathChunk::makeMetaDataTable() const {
+  return std::allocate_shared<MetaDataTable>(std::pmr::polymorphic_allocator<MetaDataTable>(m_resource), m_resource);
 }
 
-void ToolPathPoint::setCommentIndex(int comment_index) {
-  if (!m_data) {
-    m_data = ToolPathPointMetaData();
+const ToolPathChunk::LocationRuns& ToolPathChunk::runs() const {
+  static const LocationRuns empty_runs(std::pmr::new_delete_resource());
+  return m_runs ? *m_runs : empty_runs;
+}
+
+ToolPathChunk::LocationRuns& ToolPathChunk::mutableRuns() {
+  decodeLocations();
+  if (!m_runs) {
+    m_runs = makeRuns();
+  } else if (m_runs.use_count() > 1) {
+    m_runs = std::allocate_shared<LocationRuns>(std::pmr::polymorphic_allocator<LocationRuns>(m_resource),
+                                                *m_runs, m_resource);
   }
 
-  m_data->setCommentIndex(comment_index);
+  m_runs->version++;
+  return *m_runs;
 }
 
-void ToolPathPoint::setDataIndex(int data_index) {
-  if (!m_data) {
-    m_data = ToolPathPointMetaData();
+void ToolPathChunk::encodeLocations(float tolerance) {
+  if (!m_runs || m_runs->isEncoded() || m_runs->starts.empty()) {
+    return;
   }
 
-  m_data->setDataIndex(data_index);
+  // Compressed runs are written to new table, old one may be shared.
+  auto encoded_runs = makeRuns();
+  if (!encoded_runs->encoded.encode(m_runs->locations.data(), m_runs->locations.size(), tolerance)) {
+    return;
+  }
+  encoded_runs->starts.assign(m_runs->starts.begin(), m_runs->starts.end());
+  m_runs = std::move(encoded_runs);
 }
 
-ToolPath::ToolPath(int n_points) : m_path(n_points), m_point_indices_map(n_points, nullptr) {
-  int point_counter = 0;
-  for (auto& path_point : m_path){
-    m_point_indices_map[point_counter] = &path_point;
-    point_counter++;
+void ToolPathChunk::decodeLocations() {
+  if (!m_runs || !m_runs->isEncoded()) {
+    return;
   }
+
+  auto decoded_runs = makeRuns();
+  decoded_runs->starts.assign(m_runs->starts.begin(), m_runs->starts.end());
+  decoded_runs->locations.resize(m_runs->encoded.size());
+  m_runs->encoded.decode(0, m_runs->encoded.size(), decoded_runs->locations.data());
+  m_runs = std::move(decoded_runs);
 }
 
-ToolPath::ToolPath(const ToolPath& other_tool_path) : m_path(other_tool_path.m_path),
-                                                      m_current_position_set(false),
-                                                      m_point_indices_valid(false),
-                                                      m_locations(other_tool_path.m_locations),
-                                                      m_comments(other_tool_path.m_comments),
-                                                      m_data(other_tool_path.m_data) {
-  updatePointIndices();
+const ToolPathChunk::MetaDataTable& ToolPathChunk::metadataTable() const {
+  static const MetaDataTable empty_table(std::pmr::new_delete_resource());
+  return m_metadata_table ? *m_metadata_table : empty_table;
 }
 
-ToolPath::ToolPath(std::vector<ToolPath>& other_tool_paths) : m_current_position_set(false),
-                                                              m_point_indices_valid(false) {
-  // First pass - update indices in original tool paths and calculate total sizes of containers.
-  int n_paths = other_tool_paths.size();
-  if (n_paths == 0) {
+ToolPathChunk::MetaDataTable& ToolPathChunk::mutableMetaDataTable() {
+  if (!m_metadata_table) {
+    m_metadata_table = makeMetaDataTable();
+  } else if (m_metadata_table.use_count() > 1) {
+    m_metadata_table = std::allocate_shared<MetaDataTable>(std::pmr::polymorphic_allocator<MetaDataTable>(m_resource),
+                                                           *m_metadata_table, m_resource);
+  }
+
+  return *m_metadata_table;
+}
+
+int ToolPathChunk::findLocationRun(int offset) const {
+  const auto& run_starts = runs().starts;
+  auto iter = std::upper_bound(run_starts.begin(), run_starts.end(), offset);
+  return static_cast<int>(std::distance(run_starts.begin(), iter)) - 1;
+}
+
+void ToolPathChunk::setLocation(int offset, const Vector3D& location) {
+  assert(offset >= 0);
+  assert(offset < numPoints());
+  auto& runs = mutableRuns();
+  auto iter = std::lower_bound(runs.starts.begin(), runs.starts.end(), offset);
+  int run_index = std::distance(runs.starts.begin(), iter);
+  if (iter != runs.starts.end() && *iter == offset) {
+    // Run starting at this point already exists - replace its location.
+    runs.locations[run_index] = location;
+  } else {
+    runs.starts.insert(iter, offset);
+    runs.locations.insert(runs.locations.begin() + run_index, location);
+  }
+}
+
+const ToolPathPointMetaData* ToolPathChunk::findMetaData(int offset) const {
+  const auto& table = metadataTable();
+  auto iter = std::lower_bound(table.offsets.begin(), table.offsets.end(), offset);
+  if (iter == table.offsets.end() || *iter != offset) {
+    return nullptr;
+  }
+
+  return &table.metadata[std::distance(table.offsets.begin(), iter)];
+}
+
+void ToolPathChunk::resolveBases() {
+  if (m_comment_base == 0 && m_data_base == 0) {
     return;
   }
 
-  ToolPath& first_tool_path = other_tool_paths[0];
-  assert(first_tool_path.m_point_indices_valid);
-  int n_locations_total = first_tool_path.m_locations.size();
-  int n_data_total = first_tool_path.m_data.size();
-  for (int i = 1; i < n_paths; i++) {
-    ToolPath& tool_path_cur = other_tool_paths[i];
-    assert(tool_path_cur.m_point_indices_valid);
-    int n_locations_cur = tool_path_cur.m_locations.size();
-    int n_comments_cur = tool_path_cur.m_comments.size();
-    int n_data_cur = tool_path_cur.m_data.size();
-
-    for (auto& point_cur : tool_path_cur.m_path) {
-      if (point_cur.m_location_index >= 0) {
-        // Apply offset to location index.
-        point_cur.m_location_index += n_locations_total;
+  if (m_metadata_table) {
+    for (auto& metadata : mutableMetaDataTable().metadata) {
+      if (metadata.getCommentIndex() >= 0) {
+        metadata.setCommentIndex(metadata.getCommentIndex() + m_comment_base);
       }
+      if (metadata.getDataIndex() >= 0) {
+        metadata.setDataIndex(metadata.getDataIndex() + m_data_base);
+      }
+    }
+  }
+  m_comment_base = 0;
+  m_data_base = 0;
+}
 
-      if (point_cur.m_data) {
-        int data_index = point_cur.m_data->getDataIndex();
-        if (data_index >= 0) {
-          // Apply offset to daya index.
-          point_cur.m_data->setDataIndex(data_index + n_data_total);
-        }
+ToolPathPointMetaData& ToolPathChunk::getOrAddMetaData(int offset) {
+  assert(offset >= 0);
+  assert(offset < numPoints());
+  resolveBases();
+  auto& table = mutableMetaDataTable();
+  auto iter = std::lower_bound(table.offsets.begin(), table.offsets.end(), offset);
+  int metadata_index = std::distance(table.offsets.begin(), iter);
+  if (iter == table.offsets.end() || *iter != offset) {
+    table.offsets.insert(iter, offset);
+    table.metadata.insert(table.metadata.begin() + metadata_index, ToolPathPointMetaData());
+  }
+
+  return table.metadata[metadata_index];
+}
+
+void ToolPathChunk::insertPoint(int offset) {
+  assert(offset >= 0);
+  assert(offset <= numPoints());
+  m_n_points++;
+
+  // Shift location runs and metadata of the following points.
+  if (m_runs && !m_runs->starts.empty() && m_runs->starts.back() >= offset) {
+    auto& run_starts = mutableRuns().starts;
+    auto run_iter = std::lower_bound(run_starts.begin(), run_starts.end(), offset);
+    for (auto iter = run_iter; iter != run_starts.end(); iter++) {
+      (*iter)++;
+    }
+  }
+  if (m_metadata_table && !m_metadata_table->offsets.empty() && m_metadata_table->offsets.back() >= offset) {
+    auto& metadata_offsets = mutableMetaDataTable().offsets;
+    auto metadata_iter = std::lower_bound(metadata_offsets.begin(), metadata_offsets.end(), offset);
+    for (auto iter = metadata_iter; iter != metadata_offsets.end(); iter++) {
+      (*iter)++;
+    }
+  }
+}
+
+void ToolPathChunk::insertPoints(const std::vector<int>& offsets, const std::vector<Vector3D>& locations,
+                                 const std::vector<ToolPathPointMetaData>& metadata) {
+  int n_new_points = offsets.size();
+  assert(static_cast<int>(locations.size()) == n_new_points);
+  assert(static_cast<int>(metadata.size()) == n_new_points);
+  resolveBases();
+  decodeLocations();
+
+  // 1. Merge location runs. New point j lands at offsets[j] + j, existing run start shifts
+  // by the number of new points inserted at or before it.
+  // Merged runs and metadata are always written to new tables, old ones may be shared.
+  const auto& old_runs = runs();
+  int n_runs = old_runs.starts.size();
+  auto new_runs = makeRuns();
+  new_runs->starts.reserve(n_runs + n_new_points);
+  new_runs->locations.reserve(n_runs + n_new_points);
+  for (int i = 0, j = 0; i < n_runs || j < n_new_points;) {
+    if (j < n_new_points && (i == n_runs || offsets[j] <= old_runs.starts[i])) {
+      new_runs->starts.push_back(offsets[j] + j);
+      new_runs->locations.push_back(locations[j]);
+      j++;
+    } else {
+      new_runs->starts.push_back(old_runs.starts[i] + j);
+      new_runs->locations.push_back(old_runs.locations[i]);
+      i++;
+    }
+  }
+  m_runs = std::move(new_runs);
+
+  // 2. Merge metadata the same way.
+  const auto& old_table = metadataTable();
+  int n_metadata = old_table.offsets.size();
+  auto new_table = makeMetaDataTable();
+  new_table->offsets.reserve(n_metadata);
+  new_table->metadata.reserve(n_metadata);
+  for (int i = 0, j = 0; i < n_metadata || j < n_new_points;) {
+    if (j < n_new_points && (i == n_metadata || offsets[j] <= old_table.offsets[i])) {
+      if (metadata[j].getCommentIndex() >= 0 || metadata[j].getDataIndex() >= 0) {
+        new_table->offsets.push_back(offsets[j] + j);
+        new_table->metadata.push_back(metadata[j]);
       }
+      j++;
+    } else {
+      new_table->offsets.push_back(old_table.offsets[i] + j);
+      new_table->metadata.push_back(old_table.metadata[i]);
+      i++;
     }
+  }
+  m_metadata_table = std::move(new_table);
 
-    n_locations_total += n_locations_cur;
-    n_data_total += n_data_cur;
+  m_n_points += n_new_points;
+}
+
+ToolPathChunk ToolPathChunk::splitTail(int offset) {
+  assert(offset > 0);
+  assert(offset < numPoints());
+  ToolPathChunk new_chunk(m_n_points - offset, m_resource);
+  new_chunk.m_comment_base = m_comment_base;
+  new_chunk.m_data_base = m_data_base;
+  m_n_points = offset;
+  decodeLocations();
+
+  // Copy location runs starting at or after offset to the new chunk, keep the head ones.
+  // Head is rebuilt in new table as well, old one may be shared.
+  if (m_runs) {
+    const auto& old_runs = *m_runs;
+    auto run_iter = std::lower_bound(old_runs.starts.begin(), old_runs.starts.end(), offset);
+    int n_head_runs = std::distance(old_runs.starts.begin(), run_iter);
+    if (run_iter != old_runs.starts.end()) {
+      auto& tail_runs = new_chunk.mutableRuns();
+      for (auto iter = run_iter; iter != old_runs.starts.end(); iter++) {
+        tail_runs.starts.push_back(*iter - offset);
+      }
+      tail_runs.locations.assign(old_runs.locations.begin() + n_head_runs, old_runs.locations.end());
+    }
+    auto head_runs = makeRuns();
+    head_runs->starts.assign(old_runs.starts.begin(), run_iter);
+    head_runs->locations.assign(old_runs.locations.begin(), old_runs.locations.begin() + n_head_runs);
+    m_runs = std::move(head_runs);
   }
 
-  // Second pass - concatenate all the containers.
-  m_locations = std::vector<Vector3D>(n_locations_total);
-  m_data = std::vector<Data3D>(n_data_total);
-  int location_counter = 0;
-  int data_counter = 0;
-  for (int i = 0; i < n_paths; i++) {
-    ToolPath& tool_path_cur = other_tool_paths[i];
-
-    // Annotate locations.
-    for (const auto& location_cur : tool_path_cur.m_locations) {
-      m_locations[location_counter] = location_cur;
-      location_counter++;
-    }
-    tool_path_cur.m_locations.clear();
-
-    // Annotate data.
-    for (const auto& data_cur : tool_path_cur.m_data) {
-      m_data[data_counter] = data_cur;
-      data_counter++;
-    }
-    tool_path_cur.m_data.clear();
-
-    // Add comments.
-    for (const auto other_comment : tool_path_cur.m_comments) {
-      m_comments.insert(other_comment);
-    }
-    for (auto& path_point : tool_path_cur.m_path) {
-      if (path_point.m_data) {
-        int comment_index_orig = path_point.m_data->getCommentIndex();
-        if (comment_index_orig >= 0) {
-          const std::string comment_str = *std::next(tool_path_cur.m_comments.begin(), comment_index_orig);
-          auto iter = m_comments.find(comment_str);
-          assert(iter != m_comments.end());
-          int comment_index_new = std::distance(m_comments.begin(), iter);
-          path_point.m_data->setCommentIndex(comment_index_new);
-        }
+  // Copy metadata of points at or after offset to the new chunk the same way.
+  if (m_metadata_table) {
+    const auto& old_table = *m_metadata_table;
+    auto metadata_iter = std::lower_bound(old_table.offsets.begin(), old_table.offsets.end(), offset);
+    int n_head_metadata = std::distance(old_table.offsets.begin(), metadata_iter);
+    if (metadata_iter != old_table.offsets.end()) {
+      auto& tail_table = new_chunk.mutableMetaDataTable();
+      for (auto iter = metadata_iter; iter != old_table.offsets.end(); iter++) {
+        tail_table.offsets.push_back(*iter - offset);
       }
+      tail_table.metadata.assign(old_table.metadata.begin() + n_head_metadata, old_table.metadata.end());
     }
-    tool_path_cur.m_comments.clear();
+    auto head_table = makeMetaDataTable();
+    head_table->offsets.assign(old_table.offsets.begin(), metadata_iter);
+    head_table->metadata.assign(old_table.metadata.begin(), old_table.metadata.begin() + n_head_metadata);
+    m_metadata_table = std::move(head_table);
+  }
 
-    // Actual path concatenation.
-    if (i == 0) {
-      m_path = tool_path_cur.m_path;
-    } else {
-      m_path.insert(m_path.end(), tool_path_cur.m_path.begin(), tool_path_cur.m_path.end());
+  return new_chunk;
+}
+
+void ToolPathChunk::erasePoints(int first, int last) {
+  assert(first >= 0);
+  assert(first < last);
+  assert(last <= numPoints());
+  int n_erased = last - first;
+  decodeLocations();
+
+  // Runs and metadata of the kept points are written to new tables, old ones may be shared.
+  if (m_runs) {
+    const auto& old_runs = *m_runs;
+    auto new_runs = makeRuns();
+    int n_runs = old_runs.starts.size();
+    for (int i = 0; i < n_runs; i++) {
+      int start = old_runs.starts[i];
+      if (start < first || start >= last) {
+        new_runs->starts.push_back(start < first ? start : start - n_erased);
+        new_runs->locations.push_back(old_runs.locations[i]);
+      }
+    }
+    m_runs = std::move(new_runs);
+  }
+
+  if (m_metadata_table) {
+    const auto& old_table = *m_metadata_table;
+    auto new_table = makeMetaDataTable();
+    int n_metadata = old_table.offsets.size();
+    for (int i = 0; i < n_metadata; i++) {
+      int offset = old_table.offsets[i];
+      if (offset < first || offset >= last) {
+        new_table->offsets.push_back(offset < first ? offset : offset - n_erased);
+        new_table->metadata.push_back(old_table.metadata[i]);
+      }
+    }
+    m_metadata_table = std::move(new_table);
+  }
+
+  m_n_points -= n_erased;
+}
+
+void ToolPathChunk::appendPoints(ToolPathChunk& other) {
+  assert(m_comment_base == 0 && m_data_base == 0);
+  assert(other.m_comment_base == 0 && other.m_data_base == 0);
+  other.decodeLocations();
+  if (other.numLocationRuns() > 0) {
+    const auto& other_runs = other.runs();
+    auto& runs = mutableRuns();
+    for (int start : other_runs.starts) {
+      runs.starts.push_back(start + m_n_points);
+    }
+    runs.locations.insert(runs.locations.end(), other_runs.locations.begin(), other_runs.locations.end());
+  }
+  if (other.numMetaData() > 0) {
+    const auto& other_table = other.metadataTable();
+    auto& table = mutableMetaDataTable();
+    for (int offset : other_table.offsets) {
+      table.offsets.push_back(offset + m_n_points);
+    }
+    table.metadata.insert(table.metadata.end(), other_table.metadata.begin(), other_table.metadata.end());
+  }
+
+  m_n_points += other.m_n_points;
+}
+
+void ToolPathChunkIndex::build(const std::vector<ToolPathChunk>& chunks) {
+  int n_chunks = chunks.size();
+  m_tree.assign(n_chunks + 1, 0);
+  m_n_points = 0;
+  for (int i = 0; i < n_chunks; i++) {
+    int chunk_size = chunks[i].numPoints();
+    m_n_points += chunk_size;
+    int node = i + 1;
+    m_tree[node] += chunk_size;
+    int parent = node + (node & -node);
+    if (parent <= n_chunks) {
+      m_tree[parent] += m_tree[node];
+    }
+  }
+
+  m_top_bit = 1;
+  while (m_top_bit * 2 <= n_chunks) {
+    m_top_bit *= 2;
+  }
+}
+
+void ToolPathChunkIndex::push_back(int chunk_size) {
+  // Fenwick node i covers chunks (i - lowbit(i), i], sum the covered nodes of previous chunks.
+  if (m_tree.empty()) {
+    m_tree.push_back(0);
+  }
+  int node = m_tree.size();
+  ToolPathIndex sum = chunk_size;
+  for (int child = node - 1; child > node - (node & -node); child -= (child & -child)) {
+    sum += m_tree[child];
+  }
+  m_tree.push_back(sum);
+  m_n_points += chunk_size;
+  if (m_top_bit * 2 <= node) {
+    m_top_bit = (m_top_bit == 0) ? 1 : m_top_bit * 2;
+  }
+}
+
+void ToolPathChunkIndex::add(int chunk_index, int delta) {
+  int n_chunks = m_tree.size() - 1;
+  assert(chunk_index >= 0);
+  assert(chunk_index < n_chunks);
+  for (int node = chunk_index + 1; node <= n_chunks; node += (node & -node)) {
+    m_tree[node] += delta;
+  }
+  m_n_points += delta;
+}
+
+ToolPathIndex ToolPathChunkIndex::firstPoint(int chunk_index) const {
+  assert(chunk_index >= 0);
+  assert(chunk_index == 0 || chunk_index < static_cast<int>(m_tree.size()));
+  ToolPathIndex result = 0;
+  for (int node = chunk_index; node > 0; node -= (node & -node)) {
+    result += m_tree[node];
+  }
+  return result;
+}
+
+int ToolPathChunkIndex::find(ToolPathIndex point_index, int& offset) const {
+  assert(point_index >= 0);
+  assert(point_index < m_n_points);
+  int n_chunks = m_tree.size() - 1;
+  int node = 0;
+  ToolPathIndex remainder = point_index;
+  for (int step = m_top_bit; step > 0; step /= 2) {
+    int next = node + step;
+    if (next <= n_chunks && m_tree[next] <= remainder) {
+      node = next;
+      remainder -= m_tree[next];
+    }
+  }
+
+  offset = static_cast<int>(remainder);
+  return node;
+}
+
+ToolPath::ToolPath(ToolPathIndex n_points, std::pmr::memory_resource* resource)
+    : m_resource(resource), m_data(resource) {
+  m_chunks.reserve((n_points + kChunkSize - 1) / kChunkSize);
+  for (ToolPathIndex point_counter = 0; point_counter < n_points; point_counter += kChunkSize) {
+    m_chunks.emplace_back(static_cast<int>(std::min<ToolPathIndex>(kChunkSize, n_points - point_counter)), m_resource);
+  }
+  m_chunk_index.build(m_chunks);
+}
+
+ToolPath::ToolPath(const ToolPath& other_tool_path) : m_chunks(other_tool_path.m_chunks),
+                                                      m_chunk_index(other_tool_path.m_chunk_index),
+                                                      m_current_position_set(false),
+                                                      m_resource(other_tool_path.m_resource),
+                                                      m_comments(other_tool_path.m_comments),
+                                                      m_data(other_tool_path.m_data) {
+}
+
+ToolPath::ToolPath(ToolPath&& other_tool_path) noexcept
+    : m_chunks(std::move(other_tool_path.m_chunks)),
+      m_chunk_index(std::move(other_tool_path.m_chunk_index)),
+      m_current_chunk(other_tool_path.m_current_chunk),
+      m_current_offset(other_tool_path.m_current_offset),
+      m_current_position_set(std::exchange(other_tool_path.m_current_position_set, false)),
+      m_resource(other_tool_path.m_resource),
+      m_comments(std::move(other_tool_path.m_comments)),
+      m_data(std::move(other_tool_path.m_data)),
+      m_journal(std::exchange(other_tool_path.m_journal, nullptr)) {
+  other_tool_path.m_chunks.clear();
+  if (m_journal) {
+    m_journal->m_tool_path = this;
+  }
+}
+
+ToolPath& ToolPath::operator=(const ToolPath& other_tool_path) {
+  if (this == &other_tool_path) {
+    return *this;
+  }
+  if (m_journal) {
+    m_journal->recordClear();
+    m_journal->recordAppend(other_tool_path);
+  }
+  m_chunks = other_tool_path.m_chunks;
+  m_chunk_index = other_tool_path.m_chunk_index;
+  m_current_position_set = false;
+  m_resource = other_tool_path.m_resource;
+  m_comments = other_tool_path.m_comments;
+  m_data = other_tool_path.m_data;
+  return *this;
+}
+
+ToolPath& ToolPath::operator=(ToolPath&& other_tool_path) {
+  if (this == &other_tool_path) {
+    return *this;
+  }
+  if (m_journal) {
+    // Attached journal stays with this path and records the new contents, like in copy assignment.
+    m_journal->recordClear();
+    m_journal->recordAppend(other_tool_path);
+    if (other_tool_path.m_journal) {
+      other_tool_path.m_journal->recordClear();
     }
+  }
+  m_chunks = std::move(other_tool_path.m_chunks);
+  other_tool_path.m_chunks.clear();
+  m_chunk_index = std::move(other_tool_path.m_chunk_index);
+  m_current_chunk = other_tool_path.m_current_chunk;
+  m_current_offset = other_tool_path.m_current_offset;
+  m_current_position_set = std::exchange(other_tool_path.m_current_position_set, false);
+  m_resource = other_tool_path.m_resource;
+  m_comments = std::move(other_tool_path.m_comments);
+  m_data = std::move(other_tool_path.m_data);
+  if (!m_journal) {
+    m_journal = std::exchange(other_tool_path.m_journal, nullptr);
+    if (m_journal) {
+      m_journal->m_tool_path = this;
+    }
+  }
+  return *this;
+}
+
+ToolPath::ToolPath(std::vector<ToolPath>& other_tool_paths)
+    : m_current_position_set(false),
+      m_resource(other_tool_paths.empty() ? std::pmr::get_default_resource() : other_tool_paths.front().m_resource),
+      m_data(m_resource) {
+  int n_paths = other_tool_paths.size();
+  if (n_paths == 0) {
+    return;
+  }
 
-    // Clear current tool path to minimize memory.
+  // First pass - prefix sums of chunk counts define where each path lands in m_chunks.
+  // Comment pools are small, they are appended sequentially.
+  std::vector<int> chunk_offsets(n_paths + 1, 0);
+  std::vector<int> comment_bases(n_paths);
+  std::vector<TensorArena*> data_arenas(n_paths);
+  for (int i = 0; i < n_paths; i++) {
+    auto& tool_path_cur = other_tool_paths[i];
+    chunk_offsets[i + 1] = chunk_offsets[i] + tool_path_cur.m_chunks.size();
+    comment_bases[i] = m_comments.append(tool_path_cur.m_comments);
+    data_arenas[i] = &tool_path_cur.m_data;
+  }
+  const auto data_bases = m_data.appendAll(data_arenas);
+
+  // Second pass - move chunks of all the paths in parallel into preallocated m_chunks,
+  // chunks are moved together with their locations and metadata.
+  m_chunks.resize(chunk_offsets[n_paths]);
+  #pragma omp parallel for schedule(dynamic)
+  for (int i = 0; i < n_paths; i++) {
+    auto& tool_path_cur = other_tool_paths[i];
+    int chunk_index = chunk_offsets[i];
+    for (auto& chunk_cur : tool_path_cur.m_chunks) {
+      chunk_cur.m_comment_base += comment_bases[i];
+      chunk_cur.m_data_base += data_bases[i];
+      m_chunks[chunk_index] = std::move(chunk_cur);
+      chunk_index++;
+    }
+  }
+
+  // Clear the paths to minimize memory, sequentially since memory resources may not be thread-safe.
+  for (auto& tool_path_cur : other_tool_paths) {
     tool_path_cur.clear();
   }
 
-  updatePointIndices();
+  m_chunk_index.build(m_chunks);
   other_tool_paths.clear();
 }
 
-void ToolPath::updatePointIndices() {
-  if (!m_point_indices_valid) {
-    m_point_indices_map = std::vector<ToolPathPoint*>(m_path.size(), nullptr);
-    int point_counter = 0;
-    for (auto& path_point : m_path){
-      m_point_indices_map[point_counter] = &path_point;
-      point_counter++;
-    }
+void ToolPath::splitChunk(int chunk_index, int offset) {
+  auto new_chunk = m_chunks[chunk_index].splitTail(offset);
+  m_chunks.insert(m_chunks.begin() + chunk_index + 1, std::move(new_chunk));
+  m_chunk_index.build(m_chunks);
+}
+
+void ToolPath::nextPosition(int& chunk_index, int& offset) const {
+  int n_chunks = m_chunks.size();
+  offset++;
+  if (offset < m_chunks[chunk_index].numPoints()) {
+    return;
+  }
 
-    m_point_indices_valid = true;
-    m_current_position_set = false;
+  offset = 0;
+  chunk_index++;
+  while (chunk_index < n_chunks && m_chunks[chunk_index].numPoints() == 0) {
+    chunk_index++;
   }
 }
 
+void ToolPath::prevPosition(int& chunk_index, int& offset) const {
+  if (offset > 0) {
+    offset--;
+    return;
+  }
+
+  chunk_index--;
+  while (m_chunks[chunk_index].numPoints() == 0) {
+    chunk_index--;
+  }
+  offset = m_chunks[chunk_index].numPoints() - 1;
+}
+
+int ToolPath::findPosition(ToolPathIndex point_index, int& offset) const {
+  assert(point_index >= 0);
+  assert(point_index <= numPoints());
+  if (point_index == numPoints()) {
+    offset = 0;
+    return m_chunks.size();
+  }
+
+  return m_chunk_index.find(point_index, offset);
+}
+
 void ToolPath::getFirst() {
-  m_current_position = m_path.begin();
+  m_current_chunk = 0;
+  m_current_offset = 0;
   m_current_position_set = true;
 }
 
 bool ToolPath::getNext() {
   assert(m_current_position_set);
-  if (m_current_position == m_path.end()) {
+  int n_chunks = m_chunks.size();
+  if (m_current_chunk >= n_chunks) {
     return false;
   }
 
-  m_current_position++;
-  return (m_current_position != m_path.end());
-}
-
-void ToolPath::setLocation(int point_index, const Vector3D& location) {
-  if (!m_point_indices_valid) {
-    updatePointIndices();
+  m_current_offset++;
+  if (m_current_offset >= m_chunks[m_current_chunk].numPoints()) {
+    m_current_chunk++;
+    m_current_offset = 0;
   }
+  return (m_current_chunk < n_chunks);
+}
 
-  if (m_locations.empty()) {
-    // This is initial point of trajectory, it must always be at index = 0
-    assert(point_index == 0);
-  } else {
-    int n_points = m_path.size();
-    auto* path_point = m_point_indices_map[point_index];
-    if (point_index > 0) {
-      // Annotate location indices of the previous path points.
-      int location_index_init = path_point->getLocationIndex();
-      if (location_index_init < 0) {
-         int annotated_point_index = point_index;
-         for(int i = point_index; i >= 0; i--) {
-          const auto* path_point_cur = m_point_indices_map[i];
-          int location_index_cur = path_point_cur->getLocationIndex();
-          if (location_index_cur >= 0) {
-            annotated_point_index = i;
-            break;
-          }
-         }
-
-         assert(annotated_point_index != point_index);
-         int prev_location_index = m_point_indices_map[annotated_point_index]->getLocationIndex();
-         assert(prev_location_index >= 0);
-         for(int i = annotated_point_index + 1; i < point_index; i++) {
-          m_point_indices_map[i]->setLocationIndex(prev_location_index);
-         }
-      }
+std::optional<Vector3D> ToolPath::findLocation(int chunk_index, int offset) const {
+  for (; chunk_index >= 0; chunk_index--) {
+    const auto& chunk = m_chunks[chunk_index];
+    int run_index = chunk.findLocationRun(offset);
+    if (run_index >= 0) {
+      return chunk.runs().location(run_index);
     }
 
-    if (point_index < n_points - 1) {
-      int location_index_init = path_point->getLocationIndex();
-      if (location_index_init >= 0) {
-        // Annotate location indices of the next path points.
-        int location_index_new = m_locations.size();
-        for(int i = point_index + 1; i < n_points; i++) {
-          auto* path_point_cur = m_point_indices_map[i];
-          int location_index_cur = path_point_cur->getLocationIndex();
-          if (location_index_cur != location_index_init) {
-            break;
-          }
-
-          path_point_cur->setLocationIndex(location_index_new);
-        }
-      }
+    // No location change in this chunk before offset - inherit from previous chunk.
+    if (chunk_index > 0) {
+      offset = m_chunks[chunk_index - 1].numPoints() - 1;
     }
   }
 
-  // Set location index for the point.
-  m_point_indices_map[point_index]->setLocationIndex(m_locations.size());
-
-  // Insert location into the locations container.
-  m_locations.push_back(location);
+  return std::nullopt;
 }
 
-void ToolPath::finalizeInitialization() {
-  if (!m_point_indices_valid) {
-    updatePointIndices();
+void ToolPath::setLocation(ToolPathIndex point_index, const Vector3D& location) {
+  if (m_journal) {
+    m_journal->recordSetLocation(point_index, location);
   }
 
-  int n_points = m_path.size();
+  int offset = 0;
+  int chunk_index = m_chunk_index.find(point_index, offset);
 
-  // Get the last existing location.
-  auto* last_point = m_point_indices_map[n_points - 1];
-  if (last_point->getLocationIndex() < 0) {
-    // 1. Find last point index with annotated location.
-    int last_annotated_point_index = -1;
-    for(int i = n_points - 2; i >=0; i--) {
-      auto* path_point_cur = m_point_indices_map[i];
-      if(path_point_cur->getLocationIndex() >= 0) {
-        last_annotated_point_index = i;
-        break;
-      }
-    }
+  // Initial point of trajectory must always be annotated first.
+  assert(point_index == 0 || findLocation(chunk_index, offset).has_value());
 
-    assert(last_annotated_point_index >=0);
-    assert(last_annotated_point_index < n_points);
+  // Start new location run, following points up to the next run inherit the location.
+  m_chunks[chunk_index].setLocation(offset, location);
+}
 
-    int location_index = m_point_indices_map[last_annotated_point_index]->getLocationIndex();
-    for(int i = last_annotated_point_index + 1; i < n_points; i++) {
-      m_point_indices_map[i]->setLocationIndex(location_index);
+void ToolPath::finalizeInitialization() {
+  assert(numPoints() == 0 || findLocation(0, 0).has_value());
+
+  // Resize location runs and m_data to actual capacity to optimize memory (shared runs are left as is).
+  int n_chunks = m_chunks.size();
+  #pragma omp parallel for schedule(static) if(isThreadSafeResource(m_resource))
+  for (int i = 0; i < n_chunks; i++) {
+    auto& chunk = m_chunks[i];
+    if (chunk.m_runs && chunk.m_runs.use_count() == 1) {
+      chunk.m_runs->starts.shrink_to_fit();
+      chunk.m_runs->locations.shrink_to_fit();
     }
   }
+  m_data.shrinkToFit();
+}
+
+void ToolPath::compressLocations(float tolerance) {
+  assert(tolerance > 0.);
+  int n_chunks = m_chunks.size();
+  #pragma omp parallel for schedule(dynamic) if(isThreadSafeResource(m_resource))
+  for (int i = 0; i < n_chunks; i++) {
+    m_chunks[i].encodeLocations(tolerance);
+  }
 
-  // Resize m_data to actual capacity to optimize memory.
-  m_data.shrink_to_fit();
-  m_locations.shrink_to_fit();
+  // Quantization depends on chunk layout, so compressed locations are persisted by checkpoint.
+  if (m_journal) {
+    m_journal->checkpoint();
+  }
 }
 
-void ToolPath::setComment(int point_index, const std::string& comment_str) {
-  if (!m_point_indices_valid) {
-    updatePointIndices();
+size_t ToolPath::locationsMemoryUsage() const {
+  size_t result = 0;
+  for (const auto& chunk : m_chunks) {
+    const auto& runs = chunk.runs();
+    result += runs.starts.capacity() * sizeof(int) + runs.locations.capacity() * sizeof(Vector3D) +
+              runs.encoded.memoryUsage();
   }
+  return result;
+}
 
-  // Check if comments exists in m_comments.
-  auto iter = m_comments.find(comment_str);
-  if (iter == m_comments.end()) {
-    m_comments.insert(comment_str);
+void ToolPath::setComment(ToolPathIndex point_index, std::string_view comment_str) {
+  if (m_journal) {
+    m_journal->recordSetComment(point_index, comment_str);
   }
-  iter = m_comments.find(comment_str);
-  assert(iter != m_comments.end());
-  int index = std::distance(m_comments.begin(), iter);
 
-  m_point_indices_map[point_index]->setCommentIndex(index);
+  int index = m_comments.intern(comment_str);
+
+  int offset = 0;
+  int chunk_index = m_chunk_index.find(point_index, offset);
+  m_chunks[chunk_index].getOrAddMetaData(offset).setCommentIndex(index);
 }
 
-void ToolPath::setData(int point_index, const Data3D& values) {
-  if (!m_point_indices_valid) {
-    updatePointIndices();
+void ToolPath::setData(ToolPathIndex point_index, const Data3D& values) {
+  if (m_journal) {
+    m_journal->recordSetData(point_index, values);
   }
 
-  int index = m_data.size();
-  m_data.push_back(values);
-  m_point_indices_map[point_index]->setDataIndex(index);
+  int index = m_data.add(values);
+
+  int offset = 0;
+  int chunk_index = m_chunk_index.find(point_index, offset);
+  m_chunks[chunk_index].getOrAddMetaData(offset).setDataIndex(index);
 }
 
-ToolPathPointInfo ToolPath::getToolPathPointInfo(int point_index) {
-  if (!m_point_indices_valid) {
-    updatePointIndices();
+void ToolPath::setData(ToolPathIndex point_index, const Tensor3DView& values) {
+  if (m_journal) {
+    m_journal->recordSetData(point_index, values);
   }
 
+  int index = m_data.add(values);
+
+  int offset = 0;
+  int chunk_index = m_chunk_index.find(point_index, offset);
+  m_chunks[chunk_index].getOrAddMetaData(offset).setDataIndex(index);
+}
+
+ToolPathPointInfo ToolPath::getToolPathPointInfo(ToolPathIndex point_index) const {
+  const auto view = getToolPathPointView(point_index);
+
   ToolPathPointInfo result;
+  result.location = view.location;
+  if (view.comment) {
+    result.comment = std::string(*view.comment);
+  }
+  if (view.data) {
+    result.data = view.data->toData3D();
+  }
+
+  return result;
+}
+
+ToolPathPointView ToolPath::getToolPathPointView(ToolPathIndex point_index) const {
+  int offset = 0;
+  int chunk_index = m_chunk_index.find(point_index, offset);
+  return getPointViewAt(chunk_index, offset);
+}
 
-  const auto* path_point = m_point_indices_map[point_index];
+ToolPathPointView ToolPath::getPointViewAt(int chunk_index, int offset) const {
+  ToolPathPointView result;
 
   // Get location.
-  const auto location_index = path_point->getLocationIndex();
-  assert(location_index >= 0);
-  assert(location_index < static_cast<int>(m_locations.size()));
-  result.location = m_locations[location_index];
+  const auto location = findLocation(chunk_index, offset);
+  assert(location);
+  result.location = *location;
 
-  if (path_point->m_data) {
+  const auto& chunk = m_chunks[chunk_index];
+  const auto* metadata = chunk.findMetaData(offset);
+  if (metadata) {
     // Get comment string.
-    int comment_index = path_point->m_data->getCommentIndex();
+    int comment_index = metadata->getCommentIndex();
     if (comment_index >= 0) {
-      assert(comment_index < static_cast<int>(m_comments.size()));
-      result.comment = *std::next(m_comments.begin(), comment_index);
+      result.comment = m_comments.get(chunk.m_comment_base + comment_index);
     }
 
     // Get data.
-    int data_index = path_point->m_data->getDataIndex();
+    int data_index = metadata->getDataIndex();
     if (data_index >= 0) {
-      assert(data_index < static_cast<int>(m_data.size()));
-      result.data = m_data[data_index];
+      result.data = m_data.get(chunk.m_data_base + data_index);
     }
   }
 
   return result;
 }
 
+void ToolPath::gather(ToolPathIndex first_point_index, ToolPathIndex last_point_index,
+                      const ToolPathPointBatch& batch) const {
+  assert(0 <= first_point_index && first_point_index <= last_point_index && last_point_index <= numPoints());
+  size_t n_points = last_point_index - first_point_index;
+  size_t n_words = ToolPathPointBatch::numBitmapWords(n_points);
+  if (batch.has_comment) {
+    std::fill_n(batch.has_comment, n_words, 0);
+  }
+  if (batch.has_data) {
+    std::fill_n(batch.has_data, n_words, 0);
+  }
+  if (n_points == 0) {
+    return;
+  }
+
+  int offset = 0;
+  int chunk_index = m_chunk_index.find(first_point_index, offset);
+  const auto first_location = findLocation(chunk_index, offset);
+  assert(first_location);
+  Vector3D location = *first_location;
+
+  // Runs starting at offset are already applied to the first point.
+  int run_index = m_chunks[chunk_index].findLocationRun(offset) + 1;
+  for (size_t position = 0; position < n_points; chunk_index++, offset = 0, run_index = 0) {
+    const auto& chunk = m_chunks[chunk_index];
+    const auto& runs = chunk.runs();
+    int first_offset = offset;
+    size_t chunk_position = position;
+    int end_offset = std::min<ToolPathIndex>(chunk.numPoints(), offset + (n_points - position));
+    int n_runs = runs.starts.size();
+
+    // Compressed locations of runs starting in [first_offset, end_offset) are decoded straight into the tail
+    // of the chunk part of the batch. Each run starts at least one point before its decoded location,
+    // so filling points up to the run start never overwrites locations which are not read yet.
+    int first_run = run_index;
+    size_t decoded_position = 0;
+    if (runs.isEncoded()) {
+      int end_run = std::lower_bound(runs.starts.begin() + run_index, runs.starts.end(), end_offset) -
+                    runs.starts.begin();
+      decoded_position = chunk_position + (end_offset - first_offset) - (end_run - first_run);
+      runs.encoded.decode(first_run, end_run - first_run, batch.x + decoded_position, batch.y + decoded_position,
+                          batch.z + decoded_position);
+    }
+
+    while (offset < end_offset) {
+      // Points up to the next run start share location.
+      int span_end = run_index < n_runs ? std::min(runs.starts[run_index], end_offset) : end_offset;
+      std::fill_n(batch.x + position, span_end - offset, location[0]);
+      std::fill_n(batch.y + position, span_end - offset, location[1]);
+      std::fill_n(batch.z + position, span_end - offset, location[2]);
+      position += span_end - offset;
+      offset = span_end;
+      if (offset < end_offset && run_index < n_runs && runs.starts[run_index] == offset) {
+        if (runs.isEncoded()) {
+          size_t decoded_index = decoded_position + (run_index - first_run);
+          location = Vector3D{batch.x[decoded_index], batch.y[decoded_index], batch.z[decoded_index]};
+        } else {
+          location = runs.locations[run_index];
+        }
+        run_index++;
+      }
+    }
+
+    if ((batch.has_comment || batch.has_data) && chunk.m_metadata_table) {
+      const auto& table = *chunk.m_metadata_table;
+      int metadata_index = std::lower_bound(table.offsets.begin(), table.offsets.end(), first_offset) -
+                           table.offsets.begin();
+      int n_metadata = table.offsets.size();
+      for (; metadata_index < n_metadata && table.offsets[metadata_index] < end_offset; metadata_index++) {
+        size_t bit = chunk_position + (table.offsets[metadata_index] - first_offset);
+        const auto& metadata = table.metadata[metadata_index];
+        if (batch.has_comment && metadata.getCommentIndex() >= 0) {
+          batch.has_comment[bit / 64] |= uint64_t(1) << (bit % 64);
+        }
+        if (batch.has_data && metadata.getDataIndex() >= 0) {
+          batch.has_data[bit / 64] |= uint64_t(1) << (bit % 64);
+        }
+      }
+    }
+  }
+}
+
+void ToolPath::gather(const std::vector<ToolPathIndex>& point_indices, const ToolPathPointBatch& batch) const {
+  size_t n_points = point_indices.size();
+  size_t n_words = ToolPathPointBatch::numBitmapWords(n_points);
+  if (batch.has_comment) {
+    std::fill_n(batch.has_comment, n_words, 0);
+  }
+  if (batch.has_data) {
+    std::fill_n(batch.has_data, n_words, 0);
+  }
+
+  // Visit points in path order, each pair holds point index and its position in the batch.
+  // Order of points with equal indices does not matter.
+  std::vector<std::pair<ToolPathIndex, size_t>> order(n_points);
+  auto less = [](const std::pair<ToolPathIndex, size_t>& a, const std::pair<ToolPathIndex, size_t>& b) {
+    return a.first < b.first;
+  };
+  size_t n_blocks = numPoints() / kChunkSize + 1;
+  bool is_sorted = std::is_sorted(point_indices.begin(), point_indices.end());
+  if (is_sorted || n_blocks > n_points) {
+    for (size_t i = 0; i < n_points; i++) {
+      order[i] = {point_indices[i], i};
+    }
+    if (!is_sorted) {
+      std::sort(order.begin(), order.end(), less);
+    }
+  } else {
+    // Counting sort by blocks of kChunkSize points, then sort of each block which fits in cache.
+    std::vector<size_t> block_starts(n_blocks + 1, 0);
+    for (auto point_index : point_indices) {
+      assert(0 <= point_index && point_index < numPoints());
+      block_starts[point_index / kChunkSize + 1]++;
+    }
+    std::partial_sum(block_starts.begin(), block_starts.end(), block_starts.begin());
+    std::vector<size_t> block_ends(block_starts.begin(), block_starts.end() - 1);
+    for (size_t i = 0; i < n_points; i++) {
+      order[block_ends[point_indices[i] / kChunkSize]++] = {point_indices[i], i};
+    }
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (size_t block = 0; block < n_blocks; block++) {
+      std::sort(order.begin() + block_starts[block], order.begin() + block_starts[block + 1], less);
+    }
+  }
+
+  // Sorted points are split into parts gathered in parallel, each part has its own chunk cursors.
+  // Bitmap words may be shared between parts, so bits are set atomically.
+  constexpr size_t kPartSize = size_t(1) << 16;
+  size_t n_parts = (n_points + kPartSize - 1) / kPartSize;
+  #pragma omp parallel for schedule(dynamic)
+  for (size_t part = 0; part < n_parts; part++) {
+    // Cursors of the current chunk, they only move forward within the chunk.
+    int chunk_index = -1;
+    ToolPathIndex chunk_first_point = 0;
+    ToolPathIndex chunk_end_point = 0;
+    const ToolPathChunk* chunk = nullptr;
+    const Vector3D* run_locations = nullptr;
+    int run_index = -1;
+    int metadata_index = 0;
+    std::optional<Vector3D> inherited_location;
+    // Compressed run locations of the current chunk, decoded into structure-of-arrays buffers.
+    std::vector<float> decoded_x;
+    std::vector<float> decoded_y;
+    std::vector<float> decoded_z;
+    size_t part_end = std::min(n_points, (part + 1) * kPartSize);
+    for (size_t i = part * kPartSize; i < part_end; i++) {
+      ToolPathIndex point_index = order[i].first;
+      size_t position = order[i].second;
+      assert(0 <= point_index && point_index < numPoints());
+      if (point_index >= chunk_end_point) {
+        int offset = 0;
+        chunk_index = m_chunk_index.find(point_index, offset);
+        chunk = &m_chunks[chunk_index];
+        chunk_first_point = point_index - offset;
+        chunk_end_point = chunk_first_point + chunk->numPoints();
+
+        const auto& runs = chunk->runs();
+        run_locations = runs.isEncoded() ? nullptr : runs.locations.data();
+        if (runs.isEncoded()) {
+          int n_runs = runs.encoded.size();
+          decoded_x.resize(n_runs);
+          decoded_y.resize(n_runs);
+          decoded_z.resize(n_runs);
+          runs.encoded.decode(0, n_runs, decoded_x.data(), decoded_y.data(), decoded_z.data());
+        }
+        run_index = -1;
+        metadata_index = 0;
+        inherited_location.reset();
+      }
+
+      // Get location from the last run starting at or before offset.
+      int offset = point_index - chunk_first_point;
+      const auto& starts = chunk->runs().starts;
+      run_index = advanceCursor(starts, run_index + 1, offset) - 1;
+      // Points before the first run of the chunk inherit location from previous chunks.
+      if (run_index < 0 && !inherited_location) {
+        inherited_location = findLocation(chunk_index, offset);
+        assert(inherited_location);
+      }
+      const Vector3D location = run_index < 0 ? *inherited_location
+                                : run_locations ? run_locations[run_index]
+                                                : Vector3D{decoded_x[run_index], decoded_y[run_index], decoded_z[run_index]};
+      batch.x[position] = location[0];
+      batch.y[position] = location[1];
+      batch.z[position] = location[2];
+
+      if ((batch.has_comment || batch.has_data) && chunk->m_metadata_table) {
+        const auto& table = *chunk->m_metadata_table;
+        metadata_index = advanceCursor(table.offsets, metadata_index, offset - 1);
+        if (metadata_index < static_cast<int>(table.offsets.size()) && table.offsets[metadata_index] == offset) {
+          const auto& metadata = table.metadata[metadata_index];
+          uint64_t bit = uint64_t(1) << (position % 64);
+          if (batch.has_comment && metadata.getCommentIndex() >= 0) {
+            #pragma omp atomic
+            batch.has_comment[position / 64] |= bit;
+          }
+          if (batch.has_data && metadata.getDataIndex() >= 0) {
+            #pragma omp atomic
+            batch.has_data[position / 64] |= bit;
+          }
+        }
+      }
+    }
+  }
+}
+
 void ToolPath::cleanUpMetaData() {
-  if (!m_point_indices_valid) {
-    updatePointIndices();
+  if (m_journal) {
+    m_journal->recordCleanUpMetaData();
   }
 
-  std::vector<Data3D>().swap(m_data);
+  m_data.clear();
   m_comments.clear();
 
-  int n_points = m_point_indices_map.size();
-  for(int i = 0; i < n_points; i++) {
-    m_point_indices_map[i]->m_data =  std::nullopt;
+  // Drop metadata side-tables of all chunks, no per-point work is needed.
+  int n_chunks = m_chunks.size();
+  #pragma omp parallel for schedule(static) if(isThreadSafeResource(m_resource))
+  for (int i = 0; i < n_chunks; i++) {
+    auto& chunk = m_chunks[i];
+    chunk.m_metadata_table.reset();
+    chunk.m_comment_base = 0;
+    chunk.m_data_base = 0;
   }
 }
 
 void ToolPath::InsertPathPointAtCurrentPosition(const Vector3D& location,
-                                                std::optional<std::string> comment,
-                                                std::optional<Data3D> data_3d) {
+                                                std::optional<std::string_view> comment,
+                                                const std::optional<Data3D>& data_3d) {
   // Insert new path point.
   assert(m_current_position_set);
-  m_current_position = m_path.insert(m_current_position, ToolPathPoint());
-  auto* path_point = &(*m_current_position);
-  m_point_indices_valid = false;
-
-  // Insert new location.
-  int location_index_new = m_locations.size();
-  m_locations.push_back(location);
-  path_point->setLocationIndex(location_index_new);
-
-  if (m_current_position != m_path.begin()) {
-    // Update location index for next path points.
-    const auto& path_point_prev = *(std::prev(m_current_position));
-    int location_index_prev = path_point_prev.getLocationIndex();
-    assert(location_index_prev >= 0);
-    for (auto iter = std::next(m_current_position); iter != m_path.end(); iter++) {
-      auto& path_point_cur = *iter;
-      if (path_point_cur.getLocationIndex() != location_index_prev) {
-        break;
-      }
+  if (m_journal) {
+    bool at_end = m_current_chunk >= static_cast<int>(m_chunks.size());
+    ToolPathIndex point_index = at_end ? numPoints() : m_chunk_index.firstPoint(m_current_chunk) + m_current_offset;
+    m_journal->recordInsertPoint(point_index, location, comment, data_3d);
+  }
+
+  if (m_current_chunk >= static_cast<int>(m_chunks.size())) {
+    // Current position is at the end of path - append to the last chunk.
+    if (m_chunks.empty()) {
+      m_chunks.emplace_back(0, m_resource);
+      m_chunk_index.build(m_chunks);
+    }
+    m_current_chunk = m_chunks.size() - 1;
+    m_current_offset = m_chunks.back().numPoints();
+  }
 
-      path_point_cur.setLocationIndex(location_index_new);
+  auto& chunk = m_chunks[m_current_chunk];
+  chunk.insertPoint(m_current_offset);
+
+  // Start new run at the new point.
+  // Following points which inherited location of the previous point now inherit the new location.
+  chunk.setLocation(m_current_offset, location);
+
+  m_chunk_index.add(m_current_chunk, 1);
+  int chunk_size = chunk.numPoints();
+  if (chunk_size > kMaxChunkSize) {
+    int half_size = chunk_size / 2;
+    splitChunk(m_current_chunk, half_size);
+    if (m_current_offset >= half_size) {
+      m_current_chunk++;
+      m_current_offset -= half_size;
     }
   }
+  auto& current_chunk = m_chunks[m_current_chunk];
 
   if (comment) {
     // Set comment.
-    // Check if comments exists in m_comments.
-    auto iter = m_comments.find(*comment);
-    if (iter == m_comments.end()) {
-      m_comments.insert(*comment);
-    }
-    iter = m_comments.find(*comment);
-    assert(iter != m_comments.end());
-    int index = std::distance(m_comments.begin(), iter);
+    int index = m_comments.intern(*comment);
 
-    path_point->setCommentIndex(index);
+    current_chunk.getOrAddMetaData(m_current_offset).setCommentIndex(index);
   }
 
   if (data_3d) {
-    int index = m_data.size();
-    m_data.push_back(*data_3d);
-    path_point->setDataIndex(index);
+    int index = m_data.add(*data_3d);
+    current_chunk.getOrAddMetaData(m_current_offset).setDataIndex(index);
   }
 }
 
-void ToolPath::append(ToolPath& other_path) {
-  // 1. Make sure paths have consistent data.
-  int n_points_orig =  numPoints();
-  int n_locations_orig =  m_locations.size();
-  int n_data_orig =  m_data.size();
-
-  // 2. Update locations.
-  m_locations.insert(m_locations.end(), other_path.m_locations.begin(), other_path.m_locations.end());
-  for(auto& path_point : other_path.m_path) {
-    path_point.setLocationIndex(path_point.getLocationIndex() + n_locations_orig);
-  }
-
-  // 3. Update data.
-  m_data.insert(m_data.end(), other_path.m_data.begin(), other_path.m_data.end());
-  for(auto& path_point : other_path.m_path) {
-    if (path_point.m_data) {
-      int data_index_orig = path_point.m_data->getDataIndex();
-      if (data_index_orig >= 0) {
-        path_point.m_data->setDataIndex(data_index_orig + n_data_orig);
-      }
-    }
+void ToolPath::insertPoints(const std::vector<ToolPathPointInsertion>& insertions) {
+  int n_insertions = insertions.size();
+  if (n_insertions == 0) {
+    return;
+  }
+  if (m_journal) {
+    m_journal->recordInsertPoints(insertions);
   }
 
-  // 4. Update comments.
-  std::set<std::string> other_comments = other_path.m_comments;
-  for(const auto other_comment : other_comments) {
-    m_comments.insert(other_comment);
+  // 1. Order insertions by position, keeping given order for equal positions.
+  std::vector<int> order(n_insertions);
+  for (int i = 0; i < n_insertions; i++) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&insertions](int a, int b) {
+    return insertions[a].point_index < insertions[b].point_index;
+  });
+  assert(insertions[order.front()].point_index >= 0);
+  assert(insertions[order.back()].point_index <= numPoints());
+
+  if (m_chunks.empty()) {
+    m_chunks.emplace_back(0, m_resource);
   }
-  for(auto& path_point : other_path.m_path) {
-    if (path_point.m_data) {
-      int comment_index_orig = path_point.m_data->getCommentIndex();
-      if (comment_index_orig >= 0) {
-        const std::string comment_str = *std::next(other_comments.begin(), comment_index_orig);
-        auto iter = m_comments.find(comment_str);
-        assert(iter != m_comments.end());
-        int comment_index_new = std::distance(m_comments.begin(), iter);
-        path_point.m_data->setCommentIndex(comment_index_new);
+
+  // 2. Single pass over chunks, each chunk gets its new points merged in and is re-split if it grew too big.
+  m_current_position_set = false;
+  std::vector<ToolPathChunk> chunks;
+  chunks.reserve(m_chunks.size() + n_insertions / kChunkSize + 1);
+  std::vector<int> offsets;
+  std::vector<Vector3D> locations;
+  std::vector<ToolPathPointMetaData> metadata;
+  int n_chunks = m_chunks.size();
+  ToolPathIndex chunk_start = 0;
+  int insertion_counter = 0;
+  for (int chunk_index = 0; chunk_index < n_chunks; chunk_index++) {
+    auto& chunk = m_chunks[chunk_index];
+    ToolPathIndex chunk_end = chunk_start + chunk.numPoints();
+    bool last_chunk = (chunk_index == n_chunks - 1);
+    offsets.clear();
+    locations.clear();
+    metadata.clear();
+    for (; insertion_counter < n_insertions; insertion_counter++) {
+      const auto& insertion = insertions[order[insertion_counter]];
+      if (insertion.point_index > chunk_end || (insertion.point_index == chunk_end && !last_chunk)) {
+        break;
+      }
+
+      offsets.push_back(static_cast<int>(insertion.point_index - chunk_start));
+      locations.push_back(insertion.location);
+      ToolPathPointMetaData metadata_cur;
+      if (insertion.comment) {
+        metadata_cur.setCommentIndex(m_comments.intern(*insertion.comment));
       }
+      if (insertion.data) {
+        metadata_cur.setDataIndex(m_data.add(*insertion.data));
+      }
+      metadata.push_back(metadata_cur);
+    }
+    chunk_start = chunk_end;
+
+    if (!offsets.empty()) {
+      chunk.insertPoints(offsets, locations, metadata);
     }
+    while (chunk.numPoints() > kMaxChunkSize) {
+      auto tail = chunk.splitTail(kChunkSize);
+      chunks.push_back(std::move(chunk));
+      chunk = std::move(tail);
+    }
+    chunks.push_back(std::move(chunk));
   }
 
-  // 5. Append path points.
-  m_current_position_set = false;
-  m_path.insert(m_path.end(), other_path.m_path.begin(), other_path.m_path.end());
+  m_chunks.swap(chunks);
+  m_chunk_index.build(m_chunks);
+}
+
+void ToolPath::spliceMetaData(ToolPath& other_path) {
+  // Comment and data ids of other_path are appended after ids of the given path,
+  // metadata of other_path chunks is remapped lazily through chunk base offsets.
+  int comment_base = m_comments.append(other_path.m_comments);
+  int data_base = m_data.append(std::move(other_path.m_data));
+  for (auto& chunk : other_path.m_chunks) {
+    chunk.m_comment_base += comment_base;
+    chunk.m_data_base += data_base;
+  }
+  other_path.m_comments.clear();
+}
+
+void ToolPath::append(ToolPath& other_path) {
+  if (m_journal) {
+    m_journal->recordAppend(other_path);
+  }
 
-  // 6. Resize m_data to actual capacity to optimize memory.
-  m_data.shrink_to_fit();
-  m_locations.shrink_to_fit();
+  // 1. Merge data and comments of other_path.
+  spliceMetaData(other_path);
 
-  // 7. Update point indices.
-  m_point_indices_valid = false;
+  // 2. Move chunks of other_path to the end of the path.
+  m_current_position_set = false;
+  for (auto& chunk : other_path.m_chunks) {
+    m_chunk_index.push_back(chunk.numPoints());
+    m_chunks.push_back(std::move(chunk));
+  }
 
-  // 8. Clear other_path for memory efficiency.
+  // 3. Clear other_path for memory efficiency.
   other_path.clear();
 }
 
-void ToolPath::insert(int point_index, ToolPath& other_path) {
+void ToolPath::insert(ToolPathIndex point_index, ToolPath& other_path) {
   assert(point_index >= 0);
   assert(point_index < numPoints());
-  
-  // 1. Make sure paths have consistent data.
-  int n_points_orig =  numPoints();
-  int n_locations_orig =  m_locations.size();
-  int n_data_orig =  m_data.size();
-
-  // 2. Update locations.
-  m_locations.insert(m_locations.end(), other_path.m_locations.begin(), other_path.m_locations.end());
-  for(auto& path_point : other_path.m_path) {
-    path_point.setLocationIndex(path_point.getLocationIndex() + n_locations_orig);
-  }
-
-  // 3. Update data.
-  m_data.insert(m_data.end(), other_path.m_data.begin(), other_path.m_data.end());
-  for(auto& path_point : other_path.m_path) {
-    if (path_point.m_data) {
-      int data_index_orig = path_point.m_data->getDataIndex();
-      if (data_index_orig >= 0) {
-        path_point.m_data->setDataIndex(data_index_orig + n_data_orig);
-      }
-    }
+  if (m_journal) {
+    m_journal->recordInsert(point_index, other_path);
   }
 
-  // 4. Update comments.
-  std::set<std::string> other_comments = other_path.m_comments;
-  for(const auto other_comment : other_comments) {
-    m_comments.insert(other_comment);
+  // 1. Merge data and comments of other_path.
+  spliceMetaData(other_path);
+
+  // 2. Split chunk at insertion position, so other_path chunks can be moved in between.
+  m_current_position_set = false;
+  int offset = 0;
+  int chunk_index = m_chunk_index.find(point_index, offset);
+  if (offset > 0) {
+    splitChunk(chunk_index, offset);
+    chunk_index++;
   }
-  for(auto& path_point : other_path.m_path) {
-    if (path_point.m_data) {
-      int comment_index_orig = path_point.m_data->getCommentIndex();
-      if (comment_index_orig >= 0) {
-        const std::string comment_str = *std::next(other_comments.begin(), comment_index_orig);
-        auto iter = m_comments.find(comment_str);
-        assert(iter != m_comments.end());
-        int comment_index_new = std::distance(m_comments.begin(), iter);
-        path_point.m_data->setCommentIndex(comment_index_new);
-      }
-    }
+
+  // Points after insertion position must not inherit location from the last run of other_path.
+  auto& chunk = m_chunks[chunk_index];
+  if (chunk.findLocationRun(0) < 0) {
+    const auto location = findLocation(chunk_index, 0);
+    assert(location);
+    chunk.setLocation(0, *location);
   }
 
-  // 5. Insert path points.
+  m_chunks.insert(m_chunks.begin() + chunk_index,
+                  std::make_move_iterator(other_path.m_chunks.begin()),
+                  std::make_move_iterator(other_path.m_chunks.end()));
+  m_chunk_index.build(m_chunks);
+
+  // 3. Clear other_path for memory efficiency.
+  other_path.clear();
+}
+
+void ToolPath::erase(ToolPathIndex first_point_index, ToolPathIndex last_point_index) {
+  assert(first_point_index >= 0);
+  assert(first_point_index <= last_point_index);
+  assert(last_point_index <= numPoints());
+  if (first_point_index == last_point_index) {
+    return;
+  }
+  if (m_journal) {
+    m_journal->recordErase(first_point_index, last_point_index);
+  }
+
+  // 1. Location of the first point after the range, it may be defined by a run in the range.
   m_current_position_set = false;
-  auto iter = m_path.begin();
-  std::advance(iter, point_index);
-  m_path.insert(iter, other_path.m_path.begin(), other_path.m_path.end());
+  std::optional<Vector3D> next_location;
+  if (last_point_index < numPoints()) {
+    next_location = getToolPathPointView(last_point_index).location;
+  }
 
-  // 6. Resize m_data to actual capacity to optimize memory.
-  m_data.shrink_to_fit();
-  m_locations.shrink_to_fit();
+  // 2. Erase points of boundary chunks and drop chunks inside the range.
+  int first_offset = 0;
+  int first_chunk = findPosition(first_point_index, first_offset);
+  int last_offset = 0;
+  int last_chunk = findPosition(last_point_index, last_offset);
+  if (first_chunk == last_chunk) {
+    m_chunks[first_chunk].erasePoints(first_offset, last_offset);
+  } else {
+    if (first_offset > 0) {
+      auto& chunk = m_chunks[first_chunk];
+      chunk.erasePoints(first_offset, chunk.numPoints());
+      first_chunk++;
+    }
+    if (last_offset > 0) {
+      m_chunks[last_chunk].erasePoints(0, last_offset);
+    }
+    m_chunks.erase(m_chunks.begin() + first_chunk, m_chunks.begin() + last_chunk);
+  }
+  m_chunks.erase(std::remove_if(m_chunks.begin(), m_chunks.end(),
+                                [](const ToolPathChunk& chunk) { return chunk.numPoints() == 0; }),
+                 m_chunks.end());
+  m_chunk_index.build(m_chunks);
+
+  // 3. The first point after the range starts its own run, like the point after insertion position in insert():
+  // joining the previous run (even with equal location) would let points inserted before it change its location.
+  if (next_location) {
+    int offset = 0;
+    int chunk_index = m_chunk_index.find(first_point_index, offset);
+    auto& chunk = m_chunks[chunk_index];
+    int run_index = chunk.findLocationRun(offset);
+    if (run_index < 0 || chunk.runs().starts[run_index] != offset) {
+      chunk.setLocation(offset, *next_location);
+    }
+  }
+}
 
-  // 7. Update point indices.
-  m_point_indices_valid = false;
+void ToolPath::compact() {
+  m_current_position_set = false;
 
-  // 8. Clear other_path for memory efficiency.
-  other_path.clear();
+  // 1. Copy comments and data referenced by path points to new pools, remap metadata.
+  StringPool comments;
+  TensorArena data(m_resource);
+  std::vector<int> comment_ids(m_comments.size(), -1);
+  std::vector<int> data_ids(m_data.size(), -1);
+  for (auto& chunk : m_chunks) {
+    chunk.resolveBases();
+    if (chunk.numMetaData() == 0) {
+      continue;
+    }
+    for (auto& metadata : chunk.mutableMetaDataTable().metadata) {
+      int comment_index = metadata.getCommentIndex();
+      if (comment_index >= 0) {
+        if (comment_ids[comment_index] < 0) {
+          comment_ids[comment_index] = comments.intern(m_comments.get(comment_index));
+        }
+        metadata.setCommentIndex(comment_ids[comment_index]);
+      }
+      int data_index = metadata.getDataIndex();
+      if (data_index >= 0) {
+        if (data_ids[data_index] < 0) {
+          data_ids[data_index] = data.add(m_data.get(data_index));
+        }
+        metadata.setDataIndex(data_ids[data_index]);
+      }
+    }
+  }
+  m_comments = std::move(comments);
+  m_data = std::move(data);
+
+  // 2. Merge small adjacent chunks.
+  std::vector<ToolPathChunk> chunks;
+  chunks.reserve(m_chunks.size());
+  for (auto& chunk : m_chunks) {
+    if (chunk.numPoints() == 0) {
+      continue;
+    }
+    if (!chunks.empty() && chunks.back().numPoints() + chunk.numPoints() <= kChunkSize) {
+      chunks.back().appendPoints(chunk);
+    } else {
+      chunks.push_back(std::move(chunk));
+    }
+  }
+  m_chunks.swap(chunks);
+  m_chunk_index.build(m_chunks);
 }
 
 void ToolPath::clear() {
-  m_path.clear();
+  if (m_journal) {
+    m_journal->recordClear();
+  }
+
+  std::vector<ToolPathChunk>().swap(m_chunks);
+  m_chunk_index.build(m_chunks);
   m_current_position_set = false;
-  m_point_indices_map.clear();
-  m_point_indices_valid = true;
-  m_locations.clear();
-  m_locations.shrink_to_fit();
   m_comments.clear();
   m_data.clear();
-  m_data.shrink_to_fit();
 }
-  
+
+template <typename Attributes>
+BasicToolPathConstIterator<Attributes>::BasicToolPathConstIterator(const ToolPath* tool_path,
+                                                                   ToolPathIndex point_index)
+    : m_tool_path(tool_path), m_point_index(point_index) {
+  m_chunk_index = m_tool_path->findPosition(point_index, m_offset);
+  seek();
+}
+
+template <typename Attributes>
+void BasicToolPathConstIterator<Attributes>::seek() {
+  if (m_point_index == m_tool_path->numPoints()) {
+    return;
+  }
+
+  const auto& chunk = m_tool_path->m_chunks[m_chunk_index];
+  m_run_index = chunk.findLocationRun(m_offset);
+  const auto location = m_tool_path->findLocation(m_chunk_index, m_offset);
+  assert(location);
+  m_view.location = *location;
+  if (m_run_index >= 0 && chunk.runs().isEncoded()) {
+    m_encoded_state = chunk.runs().encoded.stateAt(m_run_index);
+  }
+  if constexpr (kMetaData) {
+    const auto& metadata_offsets = chunk.metadataTable().offsets;
+    m_metadata_index = std::distance(metadata_offsets.begin(),
+                                     std::lower_bound(metadata_offsets.begin(), metadata_offsets.end(), m_offset));
+    updateView();
+  }
+}
+
+template <typename Attributes>
+void BasicToolPathConstIterator<Attributes>::updateView() {
+  const auto& chunk = m_tool_path->m_chunks[m_chunk_index];
+  m_view.comment.reset();
+  m_view.data.reset();
+
+  const auto& table = chunk.metadataTable();
+  if (m_metadata_index < static_cast<int>(table.offsets.size()) && table.offsets[m_metadata_index] == m_offset) {
+    const auto& metadata = table.metadata[m_metadata_index];
+    if (Attributes::kComments && metadata.getCommentIndex() >= 0) {
+      m_view.comment = m_tool_path->m_comments.get(chunk.m_comment_base + metadata.getCommentIndex());
+    }
+    if (Attributes::kData && metadata.getDataIndex() >= 0) {
+      m_view.data = m_tool_path->m_data.get(chunk.m_data_base + metadata.getDataIndex());
+    }
+  }
+}
+
+template <typename Attributes>
+BasicToolPathConstIterator<Attributes>& BasicToolPathConstIterator<Attributes>::operator++() {
+  int chunk_index = m_chunk_index;
+  m_tool_path->nextPosition(m_chunk_index, m_offset);
+  m_point_index++;
+  if (m_point_index == m_tool_path->numPoints()) {
+    return *this;
+  }
+
+  const auto& chunk = m_tool_path->m_chunks[m_chunk_index];
+  const auto& runs = chunk.runs();
+  if (m_chunk_index != chunk_index) {
+    // New chunk - location is inherited from the previous point unless the chunk starts with a run.
+    m_run_index = -1;
+    m_metadata_index = 0;
+  } else if (kMetaData && m_metadata_index < chunk.numMetaData() &&
+             chunk.metadataTable().offsets[m_metadata_index] < m_offset) {
+    m_metadata_index++;
+  }
+  if (m_run_index + 1 < static_cast<int>(runs.starts.size()) && runs.starts[m_run_index + 1] == m_offset) {
+    // Location of the current point is kept in m_view until the next run.
+    m_run_index++;
+    if (runs.isEncoded()) {
+      if (m_run_index == 0) {
+        m_encoded_state = runs.encoded.stateAt(0);
+      } else {
+        runs.encoded.advance(m_encoded_state, m_run_index);
+      }
+      m_view.location = runs.encoded.toLocation(m_encoded_state);
+    } else {
+      m_view.location = runs.locations[m_run_index];
+    }
+  }
+
+  if constexpr (kMetaData) {
+    updateView();
+  }
+  return *this;
+}
+
+template <typename Attributes>
+BasicToolPathConstIterator<Attributes>& BasicToolPathConstIterator<Attributes>::operator--() {
+  m_tool_path->prevPosition(m_chunk_index, m_offset);
+  m_point_index--;
+  seek();
+  return *this;
+}
+
+ToolPathPointView ToolPathPointRef::view() const {
+  return m_tool_path->getPointViewAt(m_chunk_index, m_offset);
+}
+
+void ToolPathPointRef::setLocation(const Vector3D& location) {
+  if (m_tool_path->m_journal) {
+    m_tool_path->m_journal->recordSetLocation(m_point_index, location);
+  }
+  m_tool_path->m_chunks[m_chunk_index].setLocation(m_offset, location);
+}
+
+void ToolPathPointRef::setComment(std::string_view comment_str) {
+  if (m_tool_path->m_journal) {
+    m_tool_path->m_journal->recordSetComment(m_point_index, comment_str);
+  }
+  int index = m_tool_path->m_comments.intern(comment_str);
+  m_tool_path->m_chunks[m_chunk_index].getOrAddMetaData(m_offset).setCommentIndex(index);
+}
+
+void ToolPathPointRef::setData(const Data3D& values) {
+  if (m_tool_path->m_journal) {
+    m_tool_path->m_journal->recordSetData(m_point_index, values);
+  }
+  int index = m_tool_path->m_data.add(values);
+  m_tool_path->m_chunks[m_chunk_index].getOrAddMetaData(m_offset).setDataIndex(index);
+}
+
+void ToolPathPointRef::setData(const Tensor3DView& values) {
+  if (m_tool_path->m_journal) {
+    m_tool_path->m_journal->recordSetData(m_point_index, values);
+  }
+  int index = m_tool_path->m_data.add(values);
+  m_tool_path->m_chunks[m_chunk_index].getOrAddMetaData(m_offset).setDataIndex(index);
+}
+
+ToolPathIterator::ToolPathIterator(ToolPath* tool_path, ToolPathIndex point_index)
+    : m_tool_path(tool_path), m_point_index(point_index) {
+  m_chunk_index = m_tool_path->findPosition(point_index, m_offset);
+}
+
+ToolPathIterator& ToolPathIterator::operator++() {
+  m_tool_path->nextPosition(m_chunk_index, m_offset);
+  m_point_index++;
+  return *this;
+}
+
+ToolPathIterator& ToolPathIterator::operator--() {
+  m_tool_path->prevPosition(m_chunk_index, m_offset);
+  m_point_index--;
+  return *this;
+}
+
+template <typename Attributes>
+BasicToolPathRange<Attributes>::BasicToolPathRange(const ToolPath& tool_path, ToolPathIndex first_point_index,
+                                                   ToolPathIndex last_point_index)
+    : m_tool_path(&tool_path), m_first(first_point_index), m_last(last_point_index) {
+  assert(first_point_index >= 0);
+  assert(first_point_index <= last_point_index);
+  assert(last_point_index <= tool_path.numPoints());
+}
+
+template <typename Attributes>
+BasicToolPathConstIterator<Attributes> BasicToolPathRange<Attributes>::begin() const {
+  return BasicToolPathConstIterator<Attributes>(m_tool_path, m_first);
+}
+
+template <typename Attributes>
+BasicToolPathConstIterator<Attributes> BasicToolPathRange<Attributes>::end() const {
+  return BasicToolPathConstIterator<Attributes>(m_tool_path, m_last);
+}
+
+template <typename Attributes>
+std::vector<BasicToolPathRange<Attributes>> BasicToolPathRange<Attributes>::split(int n_parts) const {
+  assert(n_parts > 0);
+  std::vector<BasicToolPathRange> parts;
+  parts.reserve(n_parts);
+  long long n_points = size();
+  for (int i = 0; i < n_parts; i++) {
+    ToolPathIndex first = m_first + static_cast<ToolPathIndex>(n_points * i / n_parts);
+    ToolPathIndex last = m_first + static_cast<ToolPathIndex>(n_points * (i + 1) / n_parts);
+    if (first < last) {
+      parts.emplace_back(*m_tool_path, first, last);
+    }
+  }
+
+  return parts;
+}
+
+template class BasicToolPathConstIterator<ToolPathLocationsOnly>;
+template class BasicToolPathConstIterator<ToolPathWithComments>;
+template class BasicToolPathConstIterator<ToolPathWithData>;
+template class BasicToolPathConstIterator<ToolPathAllAttributes>;
+template class BasicToolPathRange<ToolPathLocationsOnly>;
+template class BasicToolPathRange<ToolPathWithComments>;
+template class BasicToolPathRange<ToolPathWithData>;
+template class BasicToolPathRange<ToolPathAllAttributes>;
+
 } // namespace computational_geometry
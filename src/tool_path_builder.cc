@@ -0,0 +1,86 @@
+#include <tool_path_builder.h>
+
+#include <assert.h>
+#include <algorithm>
+
+namespace computational_geometry {
+
+void ToolPathBuilder::closeChunk() {
+  m_chunk_index.push_back(m_chunk.numPoints());
+  m_chunks.push_back(std::move(m_chunk));
+  m_chunk = ToolPathChunk(0, m_resource);
+}
+
+void ToolPathBuilder::addPoint(const Vector3D& location) {
+  bool location_changed = numPoints() == 0 || location != m_last_location;
+  if (m_chunk.numPoints() == ToolPath::kChunkSize) {
+    closeChunk();
+  }
+
+  // Location run is started only if location actually changes.
+  if (location_changed) {
+    auto& runs = m_chunk.mutableRuns();
+    runs.starts.push_back(m_chunk.m_n_points);
+    runs.locations.push_back(location);
+    m_last_location = location;
+  }
+  m_chunk.m_n_points++;
+}
+
+void ToolPathBuilder::addPoints(ToolPathIndex n_points) {
+  // Initial point of trajectory must always have location.
+  assert(n_points <= 0 || numPoints() > 0);
+  while (n_points > 0) {
+    if (m_chunk.numPoints() == ToolPath::kChunkSize) {
+      closeChunk();
+    }
+    int n_chunk_points = static_cast<int>(std::min<ToolPathIndex>(n_points, ToolPath::kChunkSize - m_chunk.numPoints()));
+    m_chunk.m_n_points += n_chunk_points;
+    n_points -= n_chunk_points;
+  }
+}
+
+ToolPathPointMetaData& ToolPathBuilder::getLastMetaData() {
+  assert(m_chunk.numPoints() > 0);
+  int offset = m_chunk.numPoints() - 1;
+  auto& table = m_chunk.mutableMetaDataTable();
+  if (table.offsets.empty() || table.offsets.back() != offset) {
+    table.offsets.push_back(offset);
+    table.metadata.emplace_back();
+  }
+
+  return table.metadata.back();
+}
+
+void ToolPathBuilder::setComment(std::string_view comment_str) {
+  getLastMetaData().setCommentIndex(m_comments.intern(comment_str));
+}
+
+void ToolPathBuilder::setData(const Data3D& values) {
+  getLastMetaData().setDataIndex(m_data.add(values));
+}
+
+void ToolPathBuilder::setData(const Tensor3DView& values) {
+  getLastMetaData().setDataIndex(m_data.add(values));
+}
+
+ToolPath ToolPathBuilder::build() {
+  if (m_chunk.numPoints() > 0) {
+    closeChunk();
+  }
+
+  ToolPath tool_path(0, m_resource);
+  tool_path.m_chunks = std::move(m_chunks);
+  tool_path.m_chunk_index = std::move(m_chunk_index);
+  tool_path.m_comments = std::move(m_comments);
+  tool_path.m_data = std::move(m_data);
+
+  // Reset builder.
+  m_chunks.clear();
+  m_chunk_index = ToolPathChunkIndex();
+  m_comments.clear();
+  m_data = TensorArena(m_resource);
+  return tool_path;
+}
+
+} // namespace computational_geometry
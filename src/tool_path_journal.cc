@@ -0,0 +1,635 @@
+#include <tool_path_journal.h>
+
+#include <tool_path_snapshot.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+namespace computational_geometry {
+
+namespace {
+
+constexpr char kMagic[8] = {'T', 'P', 'J', 'O', 'U', 'R', 'N', 'L'};
+
+/// Flags of optional payload fields.
+constexpr uint32_t kHasComment = 1;
+constexpr uint32_t kHasData = 2;
+
+bool fileExists(const std::string& file_name) {
+  struct stat file_stat;
+  return ::stat(file_name.c_str(), &file_stat) == 0;
+}
+
+std::vector<char> readFile(const std::string& file_name) {
+  int fd = ::open(file_name.c_str(), O_RDONLY | O_CLOEXEC);
+  struct stat file_stat;
+  if (fd < 0 || ::fstat(fd, &file_stat) != 0) {
+    if (fd >= 0) {
+      ::close(fd);
+    }
+    throw std::runtime_error("Cannot read tool path journal file: " + file_name);
+  }
+
+  std::vector<char> content(file_stat.st_size);
+  size_t position = 0;
+  while (position < content.size()) {
+    ssize_t n_read = ::read(fd, content.data() + position, content.size() - position);
+    if (n_read < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n_read <= 0) {
+      ::close(fd);
+      throw std::runtime_error("Cannot read tool path journal file: " + file_name);
+    }
+    position += n_read;
+  }
+  ::close(fd);
+  return content;
+}
+
+/// @returns false if write failed, partial writes are continued.
+bool writeAll(int fd, const char* data, size_t size) {
+  while (size > 0) {
+    ssize_t n_written = ::write(fd, data, size);
+    if (n_written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n_written <= 0) {
+      return false;
+    }
+    data += n_written;
+    size -= n_written;
+  }
+  return true;
+}
+
+/// @brief Flush file or directory to storage.
+void syncFile(const std::string& file_name) {
+  int fd = ::open(file_name.c_str(), O_RDONLY | O_CLOEXEC);
+  bool synced = fd >= 0 && ::fsync(fd) == 0;
+  if (fd >= 0) {
+    ::close(fd);
+  }
+  if (!synced) {
+    throw std::runtime_error("Cannot sync tool path file: " + file_name);
+  }
+}
+
+/// @brief Replace target file with source file and make the rename durable.
+void replaceFile(const std::string& source_file_name, const std::string& target_file_name) {
+  if (::rename(source_file_name.c_str(), target_file_name.c_str()) != 0) {
+    throw std::runtime_error("Cannot replace tool path file: " + target_file_name);
+  }
+  auto separator = target_file_name.rfind('/');
+  syncFile(separator == std::string::npos ? "." : target_file_name.substr(0, separator + 1));
+}
+
+template <typename T>
+void putValue(std::vector<char>& record, const T& value) {
+  static_assert(std::is_trivially_copyable<T>::value && sizeof(T) % 4 == 0, "Payload fields are 4-byte aligned");
+  const char* bytes = reinterpret_cast<const char*>(&value);
+  record.insert(record.end(), bytes, bytes + sizeof(T));
+}
+
+void putString(std::vector<char>& record, std::string_view str) {
+  putValue(record, static_cast<uint32_t>(str.size()));
+  record.insert(record.end(), str.begin(), str.end());
+  record.resize((record.size() + 3) / 4 * 4, 0);
+}
+
+void putTensor(std::vector<char>& record, const Tensor3DView& tensor) {
+  putValue(record, tensor.dims());
+  const char* bytes = reinterpret_cast<const char*>(tensor.data());
+  record.insert(record.end(), bytes, bytes + tensor.numElements() * sizeof(float));
+}
+
+void putTensor(std::vector<char>& record, const Data3D& data) {
+  std::array<int, 3> dims;
+  dims[0] = data.size();
+  dims[1] = data.empty() ? 0 : data[0].size();
+  dims[2] = (data.empty() || data[0].empty()) ? 0 : data[0][0].size();
+  putValue(record, dims);
+  for (const auto& data_2d : data) {
+    assert(static_cast<int>(data_2d.size()) == dims[1]);
+    for (const auto& data_1d : data_2d) {
+      assert(static_cast<int>(data_1d.size()) == dims[2]);
+      const char* bytes = reinterpret_cast<const char*>(data_1d.data());
+      record.insert(record.end(), bytes, bytes + data_1d.size() * sizeof(float));
+    }
+  }
+}
+
+/// @brief Append point insertion fields: index, location and optional comment and data.
+void putInsertion(std::vector<char>& record, ToolPathIndex point_index, const Vector3D& location,
+                  const std::optional<std::string_view>& comment, const std::optional<Data3D>& data_3d) {
+  putValue(record, static_cast<int64_t>(point_index));
+  putValue(record, location);
+  putValue(record, (comment ? kHasComment : 0) | (data_3d ? kHasData : 0));
+  if (comment) {
+    putString(record, *comment);
+  }
+  if (data_3d) {
+    putTensor(record, *data_3d);
+  }
+}
+
+} // namespace
+
+class ToolPathJournal::PayloadReader {
+  public:
+    PayloadReader(const char* payload, uint32_t payload_size) : m_position(payload), m_end(payload + payload_size) {}
+
+    template <typename T>
+    T get() {
+      T value;
+      std::memcpy(&value, take(sizeof(T)), sizeof(T));
+      return value;
+    }
+
+    std::string_view getString() {
+      uint32_t size = get<uint32_t>();
+      const char* chars = take((static_cast<size_t>(size) + 3) / 4 * 4);
+      return std::string_view(chars, size);
+    }
+
+    /// @returns tensor view into the payload, float values are aligned in the payload.
+    Tensor3DView getTensor() {
+      auto dims = get<std::array<int, 3>>();
+      if (dims[0] < 0 || dims[1] < 0 || dims[2] < 0) {
+        throw std::runtime_error("Corrupted tool path journal record");
+      }
+      size_t n_values = static_cast<size_t>(dims[0]) * dims[1] * dims[2];
+      if (n_values > static_cast<size_t>(m_end - m_position) / sizeof(float)) {
+        throw std::runtime_error("Corrupted tool path journal record");
+      }
+      return Tensor3DView(reinterpret_cast<const float*>(take(n_values * sizeof(float))), dims);
+    }
+
+    /// @returns point index, it must be in [0, last_point_index].
+    ToolPathIndex getPointIndex(ToolPathIndex last_point_index) {
+      auto point_index = get<int64_t>();
+      if (point_index < 0 || point_index > last_point_index) {
+        throw std::runtime_error("Corrupted tool path journal record");
+      }
+      return static_cast<ToolPathIndex>(point_index);
+    }
+
+    /// @returns point insertion fields written by putInsertion(), point index must be in [0, last_point_index].
+    ToolPathPointInsertion getInsertion(ToolPathIndex last_point_index) {
+      ToolPathPointInsertion insertion;
+      insertion.point_index = getPointIndex(last_point_index);
+      insertion.location = get<Vector3D>();
+      uint32_t flags = get<uint32_t>();
+      if (flags & kHasComment) {
+        insertion.comment = std::string(getString());
+      }
+      if (flags & kHasData) {
+        insertion.data = getTensor().toData3D();
+      }
+      return insertion;
+    }
+
+    bool atEnd() const { return m_position == m_end; }
+
+  private:
+    const char* take(size_t size) {
+      if (size > static_cast<size_t>(m_end - m_position)) {
+        throw std::runtime_error("Corrupted tool path journal record");
+      }
+      const char* result = m_position;
+      m_position += size;
+      return result;
+    }
+
+    const char* m_position;
+    const char* m_end;
+};
+
+ToolPathJournal::ToolPathJournal(ToolPath& tool_path, const std::string& snapshot_file_name,
+                                 const std::string& journal_file_name, size_t checkpoint_size)
+    : m_tool_path(&tool_path), m_snapshot_file_name(snapshot_file_name), m_journal_file_name(journal_file_name),
+      m_checkpoint_size(checkpoint_size) {
+  assert(!tool_path.m_journal);
+
+  // Journal of the snapshot generation is continued after its last complete record,
+  // otherwise the path is saved to new snapshot.
+  bool continued = false;
+  if (fileExists(snapshot_file_name)) {
+    m_generation = ToolPathSnapshot(snapshot_file_name).generation();
+    if (fileExists(journal_file_name)) {
+      const auto content = readFile(journal_file_name);
+      FileHeader header;
+      if (content.size() >= sizeof(FileHeader)) {
+        std::memcpy(&header, content.data(), sizeof(FileHeader));
+      }
+      if (content.size() >= sizeof(FileHeader) && std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 &&
+          header.version == kVersion && header.header_size == sizeof(FileHeader) &&
+          header.generation == m_generation) {
+        m_journal_size = forEachRecord(content, [](RecordType, const char*, uint32_t) {});
+        m_fd = ::open(journal_file_name.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+        if (m_fd < 0 || ::ftruncate(m_fd, m_journal_size) != 0) {
+          if (m_fd >= 0) {
+            ::close(m_fd);
+          }
+          throw std::runtime_error("Cannot open tool path journal file for writing: " + journal_file_name);
+        }
+        continued = true;
+      }
+    }
+  }
+  if (!continued) {
+    checkpoint();
+  }
+
+  tool_path.m_journal = this;
+}
+
+ToolPathJournal::~ToolPathJournal() {
+  m_tool_path->m_journal = nullptr;
+  ::close(m_fd);
+}
+
+void ToolPathJournal::checkpoint() {
+  // New snapshot replaces the old one first: if it is interrupted before journal is reset,
+  // the old journal is stale for the new generation and is skipped on recovery.
+  std::string snapshot_tmp_file_name = m_snapshot_file_name + ".tmp";
+  ToolPathSnapshot::save(*m_tool_path, snapshot_tmp_file_name, m_generation + 1);
+  syncFile(snapshot_tmp_file_name);
+  replaceFile(snapshot_tmp_file_name, m_snapshot_file_name);
+  m_generation++;
+
+  resetJournal();
+}
+
+void ToolPathJournal::resetJournal() {
+  std::string journal_tmp_file_name = m_journal_file_name + ".tmp";
+  FileHeader header{};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.header_size = sizeof(FileHeader);
+  header.generation = m_generation;
+
+  int fd = ::open(journal_tmp_file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  bool written = fd >= 0 && writeAll(fd, reinterpret_cast<const char*>(&header), sizeof(header)) &&
+                 ::fsync(fd) == 0;
+  if (fd >= 0) {
+    ::close(fd);
+  }
+  if (!written) {
+    throw std::runtime_error("Cannot write tool path journal file: " + journal_tmp_file_name);
+  }
+  replaceFile(journal_tmp_file_name, m_journal_file_name);
+
+  if (m_fd >= 0) {
+    ::close(m_fd);
+  }
+  m_fd = ::open(m_journal_file_name.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+  if (m_fd < 0) {
+    throw std::runtime_error("Cannot open tool path journal file for writing: " + m_journal_file_name);
+  }
+  m_journal_size = sizeof(FileHeader);
+}
+
+void ToolPathJournal::sync() {
+  if (::fdatasync(m_fd) != 0) {
+    throw std::runtime_error("Cannot sync tool path journal file: " + m_journal_file_name);
+  }
+}
+
+uint32_t ToolPathJournal::checksum(uint32_t type, const char* payload, uint32_t payload_size) {
+  // FNV-1a over record type, size and payload.
+  uint32_t hash = 2166136261u;
+  auto add_bytes = [&hash](const char* bytes, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+      hash = (hash ^ static_cast<unsigned char>(bytes[i])) * 16777619u;
+    }
+  };
+  add_bytes(reinterpret_cast<const char*>(&type), sizeof(type));
+  add_bytes(reinterpret_cast<const char*>(&payload_size), sizeof(payload_size));
+  add_bytes(payload, payload_size);
+  return hash;
+}
+
+template <typename Function>
+size_t ToolPathJournal::forEachRecord(const std::vector<char>& content, Function function) {
+  // Records are read until the first incomplete or damaged one, it can only be the tail of interrupted write.
+  size_t position = sizeof(FileHeader);
+  while (content.size() - position >= sizeof(RecordHeader)) {
+    RecordHeader header;
+    std::memcpy(&header, content.data() + position, sizeof(RecordHeader));
+    const char* payload = content.data() + position + sizeof(RecordHeader);
+    if (header.payload_size % 4 != 0 || header.payload_size > content.size() - position - sizeof(RecordHeader) ||
+        checksum(header.type, payload, header.payload_size) != header.checksum) {
+      break;
+    }
+    function(static_cast<RecordType>(header.type), payload, header.payload_size);
+    position += sizeof(RecordHeader) + header.payload_size;
+  }
+  return position;
+}
+
+void ToolPathJournal::beginRecord(RecordType type) {
+  // Path is consistent between mutations, so automatic checkpoint is done before the next record.
+  if (m_checkpoint_size > 0 && m_journal_size >= m_checkpoint_size) {
+    checkpoint();
+  }
+  m_record.resize(sizeof(RecordHeader));
+  RecordHeader header{static_cast<uint32_t>(type), 0, 0};
+  std::memcpy(m_record.data(), &header, sizeof(RecordHeader));
+}
+
+void ToolPathJournal::endRecord() {
+  RecordHeader header;
+  std::memcpy(&header, m_record.data(), sizeof(RecordHeader));
+  header.payload_size = m_record.size() - sizeof(RecordHeader);
+  header.checksum = checksum(header.type, m_record.data() + sizeof(RecordHeader), header.payload_size);
+  std::memcpy(m_record.data(), &header, sizeof(RecordHeader));
+
+  // Partially written record is cut off, so that following records are not appended after it.
+  if (!writeAll(m_fd, m_record.data(), m_record.size())) {
+    if (::ftruncate(m_fd, m_journal_size) != 0) {
+      m_journal_size = static_cast<size_t>(-1);
+    }
+    throw std::runtime_error("Cannot write tool path journal file: " + m_journal_file_name);
+  }
+  m_journal_size += m_record.size();
+
+  // Buffer of big record (appended path) is not kept.
+  if (m_record.capacity() > (size_t(1) << 20)) {
+    std::vector<char>().swap(m_record);
+  }
+}
+
+void ToolPathJournal::recordSetLocation(ToolPathIndex point_index, const Vector3D& location) {
+  beginRecord(RecordType::kSetLocation);
+  putValue(m_record, static_cast<int64_t>(point_index));
+  putValue(m_record, location);
+  endRecord();
+}
+
+void ToolPathJournal::recordSetComment(ToolPathIndex point_index, std::string_view comment_str) {
+  beginRecord(RecordType::kSetComment);
+  putValue(m_record, static_cast<int64_t>(point_index));
+  putString(m_record, comment_str);
+  endRecord();
+}
+
+void ToolPathJournal::recordSetData(ToolPathIndex point_index, const Data3D& values) {
+  beginRecord(RecordType::kSetData);
+  putValue(m_record, static_cast<int64_t>(point_index));
+  putTensor(m_record, values);
+  endRecord();
+}
+
+void ToolPathJournal::recordSetData(ToolPathIndex point_index, const Tensor3DView& values) {
+  beginRecord(RecordType::kSetData);
+  putValue(m_record, static_cast<int64_t>(point_index));
+  putTensor(m_record, values);
+  endRecord();
+}
+
+void ToolPathJournal::recordInsertPoint(ToolPathIndex point_index, const Vector3D& location,
+                                        const std::optional<std::string_view>& comment,
+                                        const std::optional<Data3D>& data_3d) {
+  beginRecord(RecordType::kInsertPoint);
+  putInsertion(m_record, point_index, location, comment, data_3d);
+  endRecord();
+}
+
+void ToolPathJournal::recordInsertPoints(const std::vector<ToolPathPointInsertion>& insertions) {
+  beginRecord(RecordType::kInsertPoints);
+  putValue(m_record, static_cast<uint32_t>(insertions.size()));
+  for (const auto& insertion : insertions) {
+    putInsertion(m_record, insertion.point_index, insertion.location, insertion.comment, insertion.data);
+  }
+  endRecord();
+}
+
+void ToolPathJournal::recordAppend(const ToolPath& other_path) {
+  beginRecord(RecordType::kAppend);
+  writePath(m_record, other_path);
+  endRecord();
+}
+
+void ToolPathJournal::recordInsert(ToolPathIndex point_index, const ToolPath& other_path) {
+  beginRecord(RecordType::kInsert);
+  putValue(m_record, static_cast<int64_t>(point_index));
+  writePath(m_record, other_path);
+  endRecord();
+}
+
+void ToolPathJournal::recordErase(ToolPathIndex first_point_index, ToolPathIndex last_point_index) {
+  beginRecord(RecordType::kErase);
+  putValue(m_record, static_cast<int64_t>(first_point_index));
+  putValue(m_record, static_cast<int64_t>(last_point_index));
+  endRecord();
+}
+
+void ToolPathJournal::recordCleanUpMetaData() {
+  beginRecord(RecordType::kCleanUpMetaData);
+  endRecord();
+}
+
+void ToolPathJournal::recordClear() {
+  beginRecord(RecordType::kClear);
+  endRecord();
+}
+
+void ToolPathJournal::writePath(std::vector<char>& record, const ToolPath& tool_path) {
+  uint64_t n_runs = 0;
+  uint64_t n_metadata = 0;
+  for (const auto& chunk : tool_path.m_chunks) {
+    n_runs += chunk.numLocationRuns();
+    n_metadata += chunk.numMetaData();
+  }
+  putValue(record, static_cast<int64_t>(tool_path.numPoints()));
+
+  // Location runs as (point index, location) pairs, compressed runs are decoded.
+  putValue(record, n_runs);
+  std::vector<Vector3D> decoded_locations;
+  ToolPathIndex first_point = 0;
+  for (const auto& chunk : tool_path.m_chunks) {
+    const auto& runs = chunk.runs();
+    const Vector3D* locations = runs.locations.data();
+    if (runs.isEncoded()) {
+      decoded_locations.resize(runs.encoded.size());
+      runs.encoded.decode(0, runs.encoded.size(), decoded_locations.data());
+      locations = decoded_locations.data();
+    }
+    for (size_t i = 0; i < runs.starts.size(); i++) {
+      putValue(record, static_cast<int64_t>(first_point + runs.starts[i]));
+      putValue(record, locations[i]);
+    }
+    first_point += chunk.numPoints();
+  }
+
+  // Metadata with comment and data values, the path has its own pools.
+  putValue(record, n_metadata);
+  first_point = 0;
+  for (const auto& chunk : tool_path.m_chunks) {
+    const auto& table = chunk.metadataTable();
+    for (size_t i = 0; i < table.offsets.size(); i++) {
+      int comment_index = table.metadata[i].getCommentIndex();
+      int data_index = table.metadata[i].getDataIndex();
+      putValue(record, static_cast<int64_t>(first_point + table.offsets[i]));
+      putValue(record, (comment_index >= 0 ? kHasComment : 0) | (data_index >= 0 ? kHasData : 0));
+      if (comment_index >= 0) {
+        putString(record, tool_path.m_comments.get(chunk.m_comment_base + comment_index));
+      }
+      if (data_index >= 0) {
+        putTensor(record, tool_path.m_data.get(chunk.m_data_base + data_index));
+      }
+    }
+    first_point += chunk.numPoints();
+  }
+}
+
+ToolPath ToolPathJournal::readPath(PayloadReader& reader, std::pmr::memory_resource* resource) {
+  auto n_points = reader.get<int64_t>();
+  if (n_points < 0 || n_points > std::numeric_limits<ToolPathIndex>::max()) {
+    throw std::runtime_error("Corrupted tool path journal record");
+  }
+  ToolPath tool_path(static_cast<ToolPathIndex>(n_points), resource);
+
+  // Runs are set on chunks directly: points before the first run inherit location of the path they are added to.
+  auto n_runs = reader.get<uint64_t>();
+  for (uint64_t i = 0; i < n_runs; i++) {
+    ToolPathIndex point_index = reader.getPointIndex(tool_path.numPoints() - 1);
+    auto location = reader.get<Vector3D>();
+    int offset = 0;
+    int chunk_index = tool_path.m_chunk_index.find(point_index, offset);
+    tool_path.m_chunks[chunk_index].setLocation(offset, location);
+  }
+
+  auto n_metadata = reader.get<uint64_t>();
+  for (uint64_t i = 0; i < n_metadata; i++) {
+    ToolPathIndex point_index = reader.getPointIndex(tool_path.numPoints() - 1);
+    uint32_t flags = reader.get<uint32_t>();
+    int offset = 0;
+    int chunk_index = tool_path.m_chunk_index.find(point_index, offset);
+    auto& chunk = tool_path.m_chunks[chunk_index];
+    if (flags & kHasComment) {
+      chunk.getOrAddMetaData(offset).setCommentIndex(tool_path.m_comments.intern(reader.getString()));
+    }
+    if (flags & kHasData) {
+      chunk.getOrAddMetaData(offset).setDataIndex(tool_path.m_data.add(reader.getTensor()));
+    }
+  }
+
+  return tool_path;
+}
+
+void ToolPathJournal::replay(ToolPath& tool_path, RecordType type, const char* payload, uint32_t payload_size) {
+  PayloadReader reader(payload, payload_size);
+
+  switch (type) {
+    case RecordType::kSetLocation: {
+      ToolPathIndex point_index = reader.getPointIndex(tool_path.numPoints() - 1);
+      tool_path.setLocation(point_index, reader.get<Vector3D>());
+      break;
+    }
+    case RecordType::kSetComment: {
+      ToolPathIndex point_index = reader.getPointIndex(tool_path.numPoints() - 1);
+      tool_path.setComment(point_index, reader.getString());
+      break;
+    }
+    case RecordType::kSetData: {
+      ToolPathIndex point_index = reader.getPointIndex(tool_path.numPoints() - 1);
+      tool_path.setData(point_index, reader.getTensor());
+      break;
+    }
+    case RecordType::kInsertPoint:
+    case RecordType::kInsertPoints: {
+      // Insertion at current position is replayed as bulk insertion of one point at the same index.
+      uint32_t n_insertions = (type == RecordType::kInsertPoint) ? 1 : reader.get<uint32_t>();
+      std::vector<ToolPathPointInsertion> insertions;
+      for (uint32_t i = 0; i < n_insertions; i++) {
+        insertions.push_back(reader.getInsertion(tool_path.numPoints()));
+      }
+      tool_path.insertPoints(insertions);
+      break;
+    }
+    case RecordType::kAppend: {
+      auto other_path = readPath(reader, tool_path.memoryResource());
+      tool_path.append(other_path);
+      break;
+    }
+    case RecordType::kInsert: {
+      ToolPathIndex point_index = reader.getPointIndex(tool_path.numPoints() - 1);
+      auto other_path = readPath(reader, tool_path.memoryResource());
+      tool_path.insert(point_index, other_path);
+      break;
+    }
+    case RecordType::kErase: {
+      ToolPathIndex first_point_index = reader.getPointIndex(tool_path.numPoints());
+      ToolPathIndex last_point_index = reader.getPointIndex(tool_path.numPoints());
+      if (first_point_index > last_point_index) {
+        throw std::runtime_error("Corrupted tool path journal record");
+      }
+      tool_path.erase(first_point_index, last_point_index);
+      break;
+    }
+    case RecordType::kCleanUpMetaData:
+      tool_path.cleanUpMetaData();
+      break;
+    case RecordType::kClear:
+      tool_path.clear();
+      break;
+    default:
+      throw std::runtime_error("Unknown tool path journal record type");
+  }
+
+  if (!reader.atEnd()) {
+    throw std::runtime_error("Corrupted tool path journal record");
+  }
+}
+
+ToolPath ToolPathJournal::recover(const std::string& snapshot_file_name, const std::string& journal_file_name,
+                                  std::pmr::memory_resource* resource) {
+  uint64_t generation = 0;
+  ToolPath tool_path = [&]() {
+    if (!fileExists(snapshot_file_name)) {
+      return ToolPath(0, resource);
+    }
+    ToolPathSnapshot snapshot(snapshot_file_name);
+    generation = snapshot.generation();
+    return snapshot.toToolPath(resource);
+  }();
+  if (!fileExists(journal_file_name)) {
+    return tool_path;
+  }
+
+  const auto content = readFile(journal_file_name);
+  FileHeader header;
+  if (content.size() < sizeof(FileHeader)) {
+    throw std::runtime_error("Invalid tool path journal file: " + journal_file_name);
+  }
+  std::memcpy(&header, content.data(), sizeof(FileHeader));
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion ||
+      header.header_size != sizeof(FileHeader)) {
+    throw std::runtime_error("Invalid tool path journal file: " + journal_file_name);
+  }
+
+  // Journal of older generation is already folded into the snapshot (checkpoint was interrupted).
+  if (header.generation < generation) {
+    return tool_path;
+  }
+  if (header.generation > generation) {
+    throw std::runtime_error("Tool path journal file does not match snapshot: " + journal_file_name);
+  }
+  forEachRecord(content, [&tool_path](RecordType type, const char* payload, uint32_t payload_size) {
+    replay(tool_path, type, payload, payload_size);
+  });
+
+  return tool_path;
+}
+
+} // namespace computational_geometry
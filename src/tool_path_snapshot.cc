@@ -0,0 +1,452 @@
+#include <tool_path_snapshot.h>
+
+#include <assert.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+namespace computational_geometry {
+
+namespace {
+
+constexpr char kMagic[8] = {'T', 'O', 'O', 'L', 'P', 'A', 'T', 'H'};
+
+/// Sequential binary writer keeping track of file position.
+class SnapshotWriter {
+  public:
+    explicit SnapshotWriter(const std::string& file_name) : m_buffer(size_t(1) << 22) {
+      m_stream.rdbuf()->pubsetbuf(m_buffer.data(), m_buffer.size());
+      m_stream.open(file_name, std::ios::binary | std::ios::trunc);
+      if (!m_stream) {
+        throw std::runtime_error("Cannot open tool path snapshot file for writing: " + file_name);
+      }
+    }
+
+    void write(const void* data, size_t size) {
+      m_stream.write(static_cast<const char*>(data), size);
+      m_position += size;
+    }
+
+    /// @brief Write zeros up to given file position.
+    void padTo(uint64_t position) {
+      assert(position >= m_position);
+      static const char zeros[64] = {};
+      while (m_position < position) {
+        write(zeros, std::min<uint64_t>(sizeof(zeros), position - m_position));
+      }
+    }
+
+    void close() {
+      m_stream.close();
+      if (!m_stream) {
+        throw std::runtime_error("Cannot write tool path snapshot file");
+      }
+    }
+
+  private:
+    std::vector<char> m_buffer;
+    std::ofstream m_stream;
+    uint64_t m_position{0};
+};
+
+} // namespace
+
+void ToolPathSnapshot::save(const ToolPath& tool_path, const std::string& file_name, uint64_t generation) {
+  const auto& chunks = tool_path.m_chunks;
+
+  // First pass - chunk records. Chunks which inherit location from previous chunks
+  // get explicit run at offset 0, so that snapshot chunks are self-contained.
+  Header header{};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.header_size = sizeof(Header);
+  header.generation = generation;
+  header.n_chunks = chunks.size();
+
+  std::vector<ChunkRecord> chunk_records(chunks.size());
+  std::vector<std::optional<Vector3D>> entry_locations(chunks.size());
+  std::optional<Vector3D> last_location;
+  for (size_t i = 0; i < chunks.size(); i++) {
+    const auto& chunk = chunks[i];
+    auto& record = chunk_records[i];
+    record = ChunkRecord{};
+    record.first_point = header.n_points;
+    record.first_run = header.n_runs;
+    record.first_metadata = header.n_metadata;
+    record.n_points = chunk.numPoints();
+    record.n_runs = chunk.numLocationRuns();
+    record.n_metadata = chunk.numMetaData();
+    if (chunk.numPoints() > 0 && chunk.findLocationRun(0) < 0 && last_location) {
+      entry_locations[i] = last_location;
+      record.n_runs++;
+      record.flags |= kEntryRunFlag;
+    }
+    if (chunk.numLocationRuns() > 0) {
+      last_location = chunk.runs().location(chunk.numLocationRuns() - 1);
+    }
+
+    header.n_points += record.n_points;
+    header.n_runs += record.n_runs;
+    header.n_metadata += record.n_metadata;
+  }
+
+  const auto& comments = tool_path.m_comments;
+  header.n_comments = comments.size();
+  for (int id = 0; id < comments.size(); id++) {
+    header.n_comment_chars += comments.get(id).size();
+  }
+
+  // Tensors sharing elements in the arena (repeated tensors) share them in the snapshot as well.
+  const auto& data = tool_path.m_data;
+  header.n_tensors = data.size();
+  std::vector<TensorRecord> tensor_records(data.size());
+  std::vector<int> written_tensors;
+  std::unordered_map<const float*, uint64_t> values_offsets;
+  for (int id = 0; id < data.size(); id++) {
+    const auto tensor = data.get(id);
+    uint64_t values_offset = header.n_tensor_values;
+    if (tensor.numElements() > 0) {
+      auto inserted = values_offsets.emplace(tensor.data(), header.n_tensor_values);
+      if (inserted.second) {
+        written_tensors.push_back(id);
+        header.n_tensor_values += tensor.numElements();
+      }
+      values_offset = inserted.first->second;
+    }
+    tensor_records[id] = TensorRecord{values_offset, {tensor.size(0), tensor.size(1), tensor.size(2)}, 0};
+  }
+
+  // Layout of sections.
+  uint64_t position = sizeof(Header);
+  auto allocate_section = [&position](uint64_t size) {
+    uint64_t offset = (position + kSectionAlignment - 1) / kSectionAlignment * kSectionAlignment;
+    position = offset + size;
+    return offset;
+  };
+  header.chunks_offset = allocate_section(header.n_chunks * sizeof(ChunkRecord));
+  header.run_starts_offset = allocate_section(header.n_runs * sizeof(int32_t));
+  header.locations_offset = allocate_section(header.n_runs * sizeof(Vector3D));
+  header.metadata_offsets_offset = allocate_section(header.n_metadata * sizeof(int32_t));
+  header.metadata_offset = allocate_section(header.n_metadata * sizeof(MetaDataRecord));
+  header.comment_spans_offset = allocate_section(header.n_comments * sizeof(CommentRecord));
+  header.comment_chars_offset = allocate_section(header.n_comment_chars);
+  header.tensors_offset = allocate_section(header.n_tensors * sizeof(TensorRecord));
+  header.tensor_values_offset = allocate_section(header.n_tensor_values * sizeof(float));
+  header.file_size = position;
+
+  // Second pass - write sections.
+  SnapshotWriter writer(file_name);
+  writer.write(&header, sizeof(header));
+
+  writer.padTo(header.chunks_offset);
+  writer.write(chunk_records.data(), chunk_records.size() * sizeof(ChunkRecord));
+
+  writer.padTo(header.run_starts_offset);
+  const int32_t zero_offset = 0;
+  for (size_t i = 0; i < chunks.size(); i++) {
+    if (entry_locations[i]) {
+      writer.write(&zero_offset, sizeof(zero_offset));
+    }
+    const auto& run_starts = chunks[i].runs().starts;
+    writer.write(run_starts.data(), run_starts.size() * sizeof(int32_t));
+  }
+
+  // Compressed runs are decoded, snapshot always keeps plain locations.
+  writer.padTo(header.locations_offset);
+  std::vector<Vector3D> decoded_locations;
+  for (size_t i = 0; i < chunks.size(); i++) {
+    if (entry_locations[i]) {
+      writer.write(&*entry_locations[i], sizeof(Vector3D));
+    }
+    const auto& runs = chunks[i].runs();
+    if (runs.isEncoded()) {
+      decoded_locations.resize(runs.encoded.size());
+      runs.encoded.decode(0, runs.encoded.size(), decoded_locations.data());
+      writer.write(decoded_locations.data(), decoded_locations.size() * sizeof(Vector3D));
+    } else {
+      writer.write(runs.locations.data(), runs.locations.size() * sizeof(Vector3D));
+    }
+  }
+
+  writer.padTo(header.metadata_offsets_offset);
+  for (const auto& chunk : chunks) {
+    const auto& metadata_offsets = chunk.metadataTable().offsets;
+    writer.write(metadata_offsets.data(), metadata_offsets.size() * sizeof(int32_t));
+  }
+
+  // Metadata indices are written as global ids with chunk bases applied.
+  writer.padTo(header.metadata_offset);
+  std::vector<MetaDataRecord> metadata_records;
+  for (const auto& chunk : chunks) {
+    const auto& metadata = chunk.metadataTable().metadata;
+    metadata_records.resize(metadata.size());
+    for (size_t j = 0; j < metadata.size(); j++) {
+      int comment_index = metadata[j].getCommentIndex();
+      int data_index = metadata[j].getDataIndex();
+      metadata_records[j].comment_index = comment_index >= 0 ? chunk.m_comment_base + comment_index : -1;
+      metadata_records[j].data_index = data_index >= 0 ? chunk.m_data_base + data_index : -1;
+    }
+    writer.write(metadata_records.data(), metadata_records.size() * sizeof(MetaDataRecord));
+  }
+
+  writer.padTo(header.comment_spans_offset);
+  uint64_t chars_offset = 0;
+  for (int id = 0; id < comments.size(); id++) {
+    CommentRecord record{chars_offset, comments.get(id).size()};
+    writer.write(&record, sizeof(record));
+    chars_offset += record.length;
+  }
+
+  writer.padTo(header.comment_chars_offset);
+  for (int id = 0; id < comments.size(); id++) {
+    auto comment = comments.get(id);
+    writer.write(comment.data(), comment.size());
+  }
+
+  writer.padTo(header.tensors_offset);
+  writer.write(tensor_records.data(), tensor_records.size() * sizeof(TensorRecord));
+
+  writer.padTo(header.tensor_values_offset);
+  for (int id : written_tensors) {
+    const auto tensor = data.get(id);
+    writer.write(tensor.data(), tensor.numElements() * sizeof(float));
+  }
+
+  writer.close();
+}
+
+ToolPathSnapshot::ToolPathSnapshot(const std::string& file_name) {
+  int fd = ::open(file_name.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Cannot open tool path snapshot file: " + file_name);
+  }
+
+  struct stat file_stat;
+  if (::fstat(fd, &file_stat) != 0 || file_stat.st_size < static_cast<off_t>(sizeof(Header))) {
+    ::close(fd);
+    throw std::runtime_error("Invalid tool path snapshot file: " + file_name);
+  }
+
+  m_mapping_size = file_stat.st_size;
+  void* mapping = ::mmap(nullptr, m_mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    throw std::runtime_error("Cannot map tool path snapshot file: " + file_name);
+  }
+  m_mapping = static_cast<const char*>(mapping);
+  m_header = section<Header>(0);
+
+  try {
+    validate(file_name);
+  } catch (...) {
+    ::munmap(const_cast<char*>(m_mapping), m_mapping_size);
+    throw;
+  }
+
+  m_chunks = section<ChunkRecord>(m_header->chunks_offset);
+  m_run_starts = section<int32_t>(m_header->run_starts_offset);
+  m_locations = section<Vector3D>(m_header->locations_offset);
+  m_metadata_offsets = section<int32_t>(m_header->metadata_offsets_offset);
+  m_metadata = section<MetaDataRecord>(m_header->metadata_offset);
+  m_comments = section<CommentRecord>(m_header->comment_spans_offset);
+  m_comment_chars = section<char>(m_header->comment_chars_offset);
+  m_tensors = section<TensorRecord>(m_header->tensors_offset);
+  m_tensor_values = section<float>(m_header->tensor_values_offset);
+}
+
+ToolPathSnapshot::~ToolPathSnapshot() {
+  ::munmap(const_cast<char*>(m_mapping), m_mapping_size);
+}
+
+void ToolPathSnapshot::validate(const std::string& file_name) const {
+  const auto& header = *m_header;
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion ||
+      header.header_size != sizeof(Header) || header.file_size != m_mapping_size) {
+    throw std::runtime_error("Invalid tool path snapshot file: " + file_name);
+  }
+  if (header.n_points > static_cast<uint64_t>(std::numeric_limits<ToolPathIndex>::max())) {
+    throw std::runtime_error("Tool path snapshot exceeds ToolPathIndex range: " + file_name);
+  }
+
+  auto check_section = [&](uint64_t offset, uint64_t n_elements, uint64_t element_size) {
+    if (offset % kSectionAlignment != 0 || offset > m_mapping_size ||
+        n_elements > (m_mapping_size - offset) / element_size) {
+      throw std::runtime_error("Corrupted tool path snapshot file: " + file_name);
+    }
+  };
+  check_section(header.chunks_offset, header.n_chunks, sizeof(ChunkRecord));
+  check_section(header.run_starts_offset, header.n_runs, sizeof(int32_t));
+  check_section(header.locations_offset, header.n_runs, sizeof(Vector3D));
+  check_section(header.metadata_offsets_offset, header.n_metadata, sizeof(int32_t));
+  check_section(header.metadata_offset, header.n_metadata, sizeof(MetaDataRecord));
+  check_section(header.comment_spans_offset, header.n_comments, sizeof(CommentRecord));
+  check_section(header.comment_chars_offset, header.n_comment_chars, 1);
+  check_section(header.tensors_offset, header.n_tensors, sizeof(TensorRecord));
+  check_section(header.tensor_values_offset, header.n_tensor_values, sizeof(float));
+  if (header.n_chunks > static_cast<uint64_t>(std::numeric_limits<int>::max()) ||
+      header.n_comments > static_cast<uint64_t>(std::numeric_limits<int>::max()) ||
+      header.n_tensors > static_cast<uint64_t>(std::numeric_limits<int>::max())) {
+    throw std::runtime_error("Corrupted tool path snapshot file: " + file_name);
+  }
+
+  // Records are validated once here, queries index sections with them unchecked.
+  auto check = [&](bool condition) {
+    if (!condition) {
+      throw std::runtime_error("Corrupted tool path snapshot file: " + file_name);
+    }
+  };
+  const auto* chunks = section<ChunkRecord>(header.chunks_offset);
+  const auto* run_starts = section<int32_t>(header.run_starts_offset);
+  const auto* metadata_offsets = section<int32_t>(header.metadata_offsets_offset);
+  uint64_t first_point = 0;
+  for (uint64_t i = 0; i < header.n_chunks; i++) {
+    const auto& chunk = chunks[i];
+    check(chunk.first_point == first_point && chunk.n_points <= static_cast<uint32_t>(std::numeric_limits<int32_t>::max()));
+    check(chunk.first_run <= header.n_runs && chunk.n_runs <= header.n_runs - chunk.first_run);
+    check(chunk.first_metadata <= header.n_metadata && chunk.n_metadata <= header.n_metadata - chunk.first_metadata);
+    first_point += chunk.n_points;
+
+    // Run starts and metadata offsets are strictly increasing offsets in the chunk,
+    // non-empty chunk starts with a run.
+    check(chunk.n_points == 0 || (chunk.n_runs > 0 && run_starts[chunk.first_run] == 0));
+    for (uint32_t j = 0; j < chunk.n_runs; j++) {
+      int32_t start = run_starts[chunk.first_run + j];
+      check(start >= 0 && static_cast<uint32_t>(start) < chunk.n_points &&
+            (j == 0 || start > run_starts[chunk.first_run + j - 1]));
+    }
+    for (uint32_t j = 0; j < chunk.n_metadata; j++) {
+      int32_t offset = metadata_offsets[chunk.first_metadata + j];
+      check(offset >= 0 && static_cast<uint32_t>(offset) < chunk.n_points &&
+            (j == 0 || offset > metadata_offsets[chunk.first_metadata + j - 1]));
+    }
+  }
+  check(first_point == header.n_points);
+
+  const auto* metadata = section<MetaDataRecord>(header.metadata_offset);
+  for (uint64_t i = 0; i < header.n_metadata; i++) {
+    check(metadata[i].comment_index >= -1 && metadata[i].comment_index < static_cast<int64_t>(header.n_comments));
+    check(metadata[i].data_index >= -1 && metadata[i].data_index < static_cast<int64_t>(header.n_tensors));
+  }
+
+  const auto* comments = section<CommentRecord>(header.comment_spans_offset);
+  for (uint64_t i = 0; i < header.n_comments; i++) {
+    check(comments[i].offset <= header.n_comment_chars &&
+          comments[i].length <= header.n_comment_chars - comments[i].offset);
+  }
+
+  const auto* tensors = section<TensorRecord>(header.tensors_offset);
+  for (uint64_t i = 0; i < header.n_tensors; i++) {
+    const auto& tensor = tensors[i];
+    check(tensor.offset <= header.n_tensor_values);
+    uint64_t n_values = 1;
+    uint64_t max_values = header.n_tensor_values - tensor.offset;
+    for (int32_t dim : tensor.dims) {
+      check(dim >= 0 && (dim == 0 || n_values <= max_values / dim));
+      n_values *= dim;
+    }
+    check(n_values <= max_values);
+  }
+}
+
+std::string_view ToolPathSnapshot::getComment(int comment_index) const {
+  assert(comment_index >= 0 && comment_index < numComments());
+  const auto& record = m_comments[comment_index];
+  return std::string_view(m_comment_chars + record.offset, record.length);
+}
+
+Tensor3DView ToolPathSnapshot::getData(int data_index) const {
+  assert(data_index >= 0 && data_index < numData());
+  const auto& record = m_tensors[data_index];
+  return Tensor3DView(m_tensor_values + record.offset, {record.dims[0], record.dims[1], record.dims[2]});
+}
+
+ToolPathPointView ToolPathSnapshot::getToolPathPointView(ToolPathIndex point_index) const {
+  assert(point_index >= 0 && point_index < numPoints());
+  ToolPathPointView result;
+
+  // Find chunk: the last one starting at or before point_index (skips empty chunks).
+  const auto* chunks_end = m_chunks + m_header->n_chunks;
+  const auto* chunk = std::upper_bound(m_chunks, chunks_end, static_cast<uint64_t>(point_index),
+                                       [](uint64_t index, const ChunkRecord& record) {
+                                         return index < record.first_point;
+                                       }) - 1;
+  int32_t offset = static_cast<int32_t>(point_index - chunk->first_point);
+
+  // Get location.
+  const auto* run_starts = m_run_starts + chunk->first_run;
+  const auto* run = std::upper_bound(run_starts, run_starts + chunk->n_runs, offset) - 1;
+  assert(run >= run_starts);
+  result.location = m_locations[chunk->first_run + (run - run_starts)];
+
+  // Get comment and data.
+  const auto* metadata_offsets = m_metadata_offsets + chunk->first_metadata;
+  const auto* metadata_offsets_end = metadata_offsets + chunk->n_metadata;
+  const auto* metadata_offset = std::lower_bound(metadata_offsets, metadata_offsets_end, offset);
+  if (metadata_offset != metadata_offsets_end && *metadata_offset == offset) {
+    const auto& metadata = m_metadata[chunk->first_metadata + (metadata_offset - metadata_offsets)];
+    if (metadata.comment_index >= 0) {
+      result.comment = getComment(metadata.comment_index);
+    }
+    if (metadata.data_index >= 0) {
+      result.data = getData(metadata.data_index);
+    }
+  }
+
+  return result;
+}
+
+ToolPath ToolPathSnapshot::toToolPath(std::pmr::memory_resource* resource) const {
+  ToolPath tool_path(0, resource);
+
+  int n_chunks = m_header->n_chunks;
+  tool_path.m_chunks.resize(n_chunks, ToolPathChunk(0, resource));
+  #pragma omp parallel for schedule(static) if(isThreadSafeResource(resource))
+  for (int i = 0; i < n_chunks; i++) {
+    const auto& record = m_chunks[i];
+    auto& chunk = tool_path.m_chunks[i];
+    chunk.m_n_points = record.n_points;
+
+    // Entry run is dropped, the path keeps location inheritance between chunks.
+    int first_run = (record.flags & kEntryRunFlag) ? 1 : 0;
+    if (static_cast<int>(record.n_runs) > first_run) {
+      auto& runs = chunk.mutableRuns();
+      const auto* run_starts = m_run_starts + record.first_run;
+      runs.starts.assign(run_starts + first_run, run_starts + record.n_runs);
+      const auto* locations = m_locations + record.first_run;
+      runs.locations.assign(locations + first_run, locations + record.n_runs);
+    }
+
+    if (record.n_metadata > 0) {
+      auto& table = chunk.mutableMetaDataTable();
+      const auto* metadata_offsets = m_metadata_offsets + record.first_metadata;
+      table.offsets.assign(metadata_offsets, metadata_offsets + record.n_metadata);
+      table.metadata.resize(record.n_metadata);
+      for (uint32_t j = 0; j < record.n_metadata; j++) {
+        const auto& metadata = m_metadata[record.first_metadata + j];
+        table.metadata[j].setCommentIndex(metadata.comment_index);
+        table.metadata[j].setDataIndex(metadata.data_index);
+      }
+    }
+  }
+  tool_path.m_chunk_index.build(tool_path.m_chunks);
+
+  // Ids are kept: duplicate comments get alias ids, tensors are copied in order.
+  for (int id = 0; id < numComments(); id++) {
+    tool_path.m_comments.add(getComment(id));
+  }
+  for (int id = 0; id < numData(); id++) {
+    tool_path.m_data.add(getData(id));
+  }
+
+  return tool_path;
+}
+
+} // namespace computational_geometry
@@ -0,0 +1,272 @@
+#include <tool_path_spatial_index.h>
+
+#include <assert.h>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+
+namespace computational_geometry {
+
+ToolPathSpatialIndex::ToolPathSpatialIndex(const ToolPath& tool_path) : m_tool_path(&tool_path) {
+  update();
+}
+
+BoundingBox3D ToolPathSpatialIndex::runsBox(const ToolPathChunk::LocationRuns& runs) {
+  BoundingBox3D result;
+  if (runs.isEncoded()) {
+    auto state = runs.encoded.stateAt(0);
+    result.extend(runs.encoded.toLocation(state));
+    for (int i = 1; i < runs.encoded.size(); i++) {
+      runs.encoded.advance(state, i);
+      result.extend(runs.encoded.toLocation(state));
+    }
+  } else {
+    for (const auto& location : runs.locations) {
+      result.extend(location);
+    }
+  }
+  return result;
+}
+
+void ToolPathSpatialIndex::update() {
+  const auto& chunks = m_tool_path->m_chunks;
+  int n_chunks = chunks.size();
+
+  // 1. Boxes of runs are reused for chunks which still hold the same unmodified runs, chunks are matched
+  // by their runs (not by position) since append() and insert() move chunks around.
+  std::unordered_map<const ToolPathChunk::LocationRuns*, int> old_chunks;
+  old_chunks.reserve(m_chunk_runs.size());
+  for (int i = 0; i < static_cast<int>(m_chunk_runs.size()); i++) {
+    if (auto runs = m_chunk_runs[i].lock()) {
+      old_chunks.emplace(runs.get(), i);
+    }
+  }
+
+  std::vector<std::weak_ptr<const ToolPathChunk::LocationRuns>> chunk_runs(n_chunks);
+  std::vector<uint64_t> chunk_runs_versions(n_chunks, 0);
+  std::vector<BoundingBox3D> runs_boxes(n_chunks);
+  for (int i = 0; i < n_chunks; i++) {
+    const auto& runs = chunks[i].m_runs;
+    if (!runs || runs->starts.empty()) {
+      continue;
+    }
+
+    // Weak reference keeps runs unshared, in-place modifications are detected by version.
+    chunk_runs[i] = runs;
+    chunk_runs_versions[i] = runs->version;
+    auto iter = old_chunks.find(runs.get());
+    bool unchanged = iter != old_chunks.end() && m_chunk_runs_versions[iter->second] == runs->version;
+    runs_boxes[i] = unchanged ? m_runs_boxes[iter->second] : runsBox(*runs);
+  }
+  m_chunk_runs.swap(chunk_runs);
+  m_chunk_runs_versions.swap(chunk_runs_versions);
+  m_runs_boxes.swap(runs_boxes);
+
+  // 2. Entry locations and first points depend on previous chunks, they are recomputed in one pass.
+  m_entry_locations.assign(n_chunks, std::nullopt);
+  m_first_points.resize(n_chunks);
+  std::optional<Vector3D> last_location;
+  ToolPathIndex n_points = 0;
+  for (int i = 0; i < n_chunks; i++) {
+    m_entry_locations[i] = last_location;
+    m_first_points[i] = n_points;
+    n_points += chunks[i].numPoints();
+    const auto& runs = chunks[i].runs();
+    if (!runs.starts.empty()) {
+      last_location = runs.location(runs.starts.size() - 1);
+    }
+  }
+
+  // 3. Tree is rebuilt bottom-up, O(n_chunks).
+  m_n_leaves = 1;
+  while (m_n_leaves < n_chunks) {
+    m_n_leaves *= 2;
+  }
+  m_tree.assign(2 * m_n_leaves, BoundingBox3D());
+  for (int i = 0; i < n_chunks; i++) {
+    const auto& chunk = chunks[i];
+    auto& box = m_tree[m_n_leaves + i];
+    box = m_runs_boxes[i];
+    const auto& run_starts = chunk.runs().starts;
+    bool has_prefix = chunk.numPoints() > 0 && (run_starts.empty() || run_starts.front() > 0);
+    if (has_prefix && m_entry_locations[i]) {
+      box.extend(*m_entry_locations[i]);
+    }
+  }
+  for (int node = m_n_leaves - 1; node > 0; node--) {
+    m_tree[node] = m_tree[2 * node];
+    m_tree[node].extend(m_tree[2 * node + 1]);
+  }
+}
+
+template <typename Function>
+void ToolPathSpatialIndex::forEachLocationRange(int chunk_index, Function function) const {
+  const auto& chunk = m_tool_path->m_chunks[chunk_index];
+  const auto& runs = chunk.runs();
+  ToolPathIndex first_point = m_first_points[chunk_index];
+  int n_runs = runs.starts.size();
+  int n_points = chunk.numPoints();
+
+  // Points before the first run inherit location from previous chunks.
+  int prefix_end = (n_runs > 0) ? runs.starts.front() : n_points;
+  if (prefix_end > 0 && m_entry_locations[chunk_index]) {
+    function(first_point, first_point + prefix_end, *m_entry_locations[chunk_index]);
+  }
+
+  EncodedLocations::State state;
+  for (int i = 0; i < n_runs; i++) {
+    Vector3D location;
+    if (runs.isEncoded()) {
+      if (i == 0) {
+        state = runs.encoded.stateAt(0);
+      } else {
+        runs.encoded.advance(state, i);
+      }
+      location = runs.encoded.toLocation(state);
+    } else {
+      location = runs.locations[i];
+    }
+    int run_end = (i + 1 < n_runs) ? runs.starts[i + 1] : n_points;
+    function(first_point + runs.starts[i], first_point + run_end, location);
+  }
+}
+
+template <typename NodeRelationFunction, typename LocationPredicate>
+std::vector<ToolPathRange> ToolPathSpatialIndex::findRanges(NodeRelationFunction node_relation,
+                                                            LocationPredicate location_matches) const {
+  std::vector<ToolPathRange> result;
+  int n_chunks = m_first_points.size();
+  if (n_chunks == 0) {
+    return result;
+  }
+
+  // Adjacent ranges are merged, ranges are found in path order.
+  auto add_range = [this, &result](ToolPathIndex first_point_index, ToolPathIndex last_point_index) {
+    if (first_point_index == last_point_index) {
+      return;
+    }
+    if (!result.empty() && result.back().lastPointIndex() == first_point_index) {
+      result.back() = ToolPathRange(*m_tool_path, result.back().firstPointIndex(), last_point_index);
+    } else {
+      result.emplace_back(*m_tool_path, first_point_index, last_point_index);
+    }
+  };
+
+  // Depth-first traversal, left child first. Node covers chunks [first_chunk, first_chunk + n_node_leaves).
+  struct StackEntry {
+    int node;
+    int first_chunk;
+    int n_node_leaves;
+  };
+  std::vector<StackEntry> stack{{1, 0, m_n_leaves}};
+  while (!stack.empty()) {
+    auto entry = stack.back();
+    stack.pop_back();
+    if (entry.first_chunk >= n_chunks || m_tree[entry.node].empty()) {
+      continue;
+    }
+
+    auto relation = node_relation(m_tree[entry.node]);
+    if (relation == NodeRelation::kOutside) {
+      continue;
+    }
+    if (relation == NodeRelation::kInside) {
+      // All points of the subtree chunks match.
+      int last_chunk = std::min(entry.first_chunk + entry.n_node_leaves, n_chunks);
+      ToolPathIndex last_point = (last_chunk < n_chunks) ? m_first_points[last_chunk] : m_tool_path->numPoints();
+      add_range(m_first_points[entry.first_chunk], last_point);
+    } else if (entry.n_node_leaves == 1) {
+      forEachLocationRange(entry.first_chunk, [&](ToolPathIndex first_point_index, ToolPathIndex last_point_index,
+                                                  const Vector3D& location) {
+        if (location_matches(location)) {
+          add_range(first_point_index, last_point_index);
+        }
+      });
+    } else {
+      int n_child_leaves = entry.n_node_leaves / 2;
+      stack.push_back({2 * entry.node + 1, entry.first_chunk + n_child_leaves, n_child_leaves});
+      stack.push_back({2 * entry.node, entry.first_chunk, n_child_leaves});
+    }
+  }
+
+  return result;
+}
+
+std::vector<ToolPathRange> ToolPathSpatialIndex::findInBox(const BoundingBox3D& box) const {
+  return findRanges(
+      [&box](const BoundingBox3D& node_box) {
+        if (!box.intersects(node_box)) {
+          return NodeRelation::kOutside;
+        }
+        return box.contains(node_box) ? NodeRelation::kInside : NodeRelation::kIntersects;
+      },
+      [&box](const Vector3D& location) { return box.contains(location); });
+}
+
+std::vector<ToolPathRange> ToolPathSpatialIndex::findInRadius(const Vector3D& center, float radius) const {
+  float radius_squared = radius * radius;
+  auto distance_squared = [&center](const Vector3D& location) {
+    float result = 0.;
+    for (int axis = 0; axis < 3; axis++) {
+      result += (location[axis] - center[axis]) * (location[axis] - center[axis]);
+    }
+    return result;
+  };
+  return findRanges(
+      [&center, radius_squared](const BoundingBox3D& node_box) {
+        if (node_box.distanceSquared(center) > radius_squared) {
+          return NodeRelation::kOutside;
+        }
+        return (node_box.maxDistanceSquared(center) <= radius_squared) ? NodeRelation::kInside
+                                                                       : NodeRelation::kIntersects;
+      },
+      [&distance_squared, radius_squared](const Vector3D& location) {
+        return distance_squared(location) <= radius_squared;
+      });
+}
+
+ToolPathIndex ToolPathSpatialIndex::findNearest(const Vector3D& location) const {
+  int n_chunks = m_first_points.size();
+  if (n_chunks == 0 || m_tree[1].empty()) {
+    return -1;
+  }
+
+  // Best-first traversal: nodes are visited in order of distance to their boxes,
+  // traversal stops when the nearest box is farther than the best point found.
+  typedef std::pair<float, int> QueueEntry;
+  std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+  queue.emplace(m_tree[1].distanceSquared(location), 1);
+  float best_distance_squared = std::numeric_limits<float>::infinity();
+  ToolPathIndex best_point_index = -1;
+  while (!queue.empty() && queue.top().first <= best_distance_squared) {
+    int node = queue.top().second;
+    queue.pop();
+    if (node >= m_n_leaves) {
+      forEachLocationRange(node - m_n_leaves, [&](ToolPathIndex first_point_index, ToolPathIndex,
+                                                  const Vector3D& run_location) {
+        float distance_squared = 0.;
+        for (int axis = 0; axis < 3; axis++) {
+          distance_squared += (run_location[axis] - location[axis]) * (run_location[axis] - location[axis]);
+        }
+        // Ties are resolved to the first point in path order.
+        if (distance_squared < best_distance_squared ||
+            (distance_squared == best_distance_squared && first_point_index < best_point_index)) {
+          best_distance_squared = distance_squared;
+          best_point_index = first_point_index;
+        }
+      });
+      continue;
+    }
+
+    for (int child : {2 * node, 2 * node + 1}) {
+      if (!m_tree[child].empty()) {
+        queue.emplace(m_tree[child].distanceSquared(location), child);
+      }
+    }
+  }
+
+  return best_point_index;
+}
+
+} // namespace computational_geometry
@@ -1,14 +1,28 @@
 // ToolPath test application.
 #include <tool_path.h>
+#include <tool_path_builder.h>
+#include <tool_path_parallel.h>
+#include <tool_path_journal.h>
+#include <tool_path_snapshot.h>
+#include <tool_path_spatial_index.h>
+#include <tool_path_versions.h>
 
 #include <unistd.h>
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
 #include <ios>
 #include <iostream>
+#include <iterator>
+#include <limits>
 #include <fstream>
+#include <memory_resource>
 #include <random>
 #include <string>
+#include <thread>
 
 // Basic procedure to populate test tool path data according to spec:
 // - create a tool path data structure as described above as a linked list
@@ -99,6 +113,77 @@ void fillToolPath(computational_geometry::ToolPath& tool_path, int step_coord_ch
   tool_path.finalizeInitialization();
 }
 
+// Streaming version of fillToolPath: produces the same path adding points, locations, comments and data in path order.
+void buildToolPath(computational_geometry::ToolPathBuilder& builder, int n_points, int step_coord_change_avg,
+                   int vector_data_size, double nodes_percentage_with_string_data, double nodes_percentage_with_3d_vector) {
+  std::default_random_engine step_generator;
+  double sigma = std::clamp(step_coord_change_avg / 2., 5., 100.);
+  std::normal_distribution<double> step_distribution(static_cast<double>(step_coord_change_avg), sigma);
+
+  std::default_random_engine coord_index_generator;
+  std::uniform_int_distribution<int> coord_index_distribution(0, 2);
+
+  std::default_random_engine velocity_generator;
+  std::uniform_real_distribution<double> velocity_distribution(-5.0, 10.0);
+
+  std::string comment_str(100, 'x');
+  int next_comment = n_points;
+  int step_comment_avg = std::clamp(static_cast<int>(100. / std::max(nodes_percentage_with_string_data, 1e-9)), 1, n_points / 2);
+  std::default_random_engine comment_step_generator;
+  double comment_sigma = std::clamp(step_comment_avg / 2., 5., n_points / 10.);
+  std::normal_distribution<double> step_comment_distribution(static_cast<double>(step_comment_avg), comment_sigma);
+  if (nodes_percentage_with_string_data > std::numeric_limits<double>::epsilon()) {
+    next_comment = 0;
+  }
+
+  std::vector<float> data_1d(vector_data_size, 1.); // All 1s.
+  std::vector<std::vector<float>> data_2d(vector_data_size, data_1d);
+  computational_geometry::Data3D data_3d(vector_data_size, data_2d);
+  int next_data = n_points;
+  int step_data_avg = std::clamp(static_cast<int>(100. / std::max(nodes_percentage_with_3d_vector, 1e-9)), 1, n_points / 2);
+  std::default_random_engine data_step_generator;
+  double data_sigma = std::clamp(step_data_avg / 2., 5., n_points / 10.);
+  std::normal_distribution<double> step_data_distribution(static_cast<double>(step_data_avg), data_sigma);
+  if (nodes_percentage_with_3d_vector > std::numeric_limits<double>::epsilon()) {
+    next_data = 0;
+  }
+
+  computational_geometry::Vector3D location_prev{0., 0., 0.};
+  int next_location = 0;
+  int step = 1;
+  while (builder.numPoints() < n_points) {
+    // Add points without changes up to the next event.
+    int i = std::min({next_location, next_comment, next_data, n_points});
+    builder.addPoints(i - builder.numPoints());
+    if (i == n_points) {
+      break;
+    }
+
+    if (i == next_location) {
+      if (i > 0) {
+        int coord_index = coord_index_distribution(coord_index_generator);
+        double velocity = velocity_distribution(velocity_generator);
+        location_prev[coord_index] += velocity * static_cast<double>(step);
+      }
+      builder.addPoint(location_prev);
+      step = std::clamp(static_cast<int>(step_distribution(step_generator)), 1, n_points / 3);
+      next_location += step;
+    } else {
+      builder.addPoints(1);
+    }
+
+    if (i == next_comment) {
+      builder.setComment(comment_str);
+      next_comment += std::clamp(static_cast<int>(step_comment_distribution(comment_step_generator)), 1, n_points / 3);
+    }
+
+    if (i == next_data) {
+      builder.setData(data_3d);
+      next_data += std::clamp(static_cast<int>(step_data_distribution(data_step_generator)), 1, n_points / 3);
+    }
+  }
+}
+
 //////////////////////////////////////////////////////////////////////////////
 //
 // process_mem_usage(double &, double &) - takes two doubles by reference,
@@ -153,13 +238,14 @@ void report_memory () {
 }
 
 /// @brief Test for sequential access of all path points.
-void testSequentialAccess(computational_geometry::ToolPath& tool_path, bool debug_output) {
+void testSequentialAccess(const computational_geometry::ToolPath& tool_path, bool debug_output) {
   int n_points = tool_path.numPoints();
   std::cout << "Sequentially access all path points..." << std::endl;
   auto start = std::chrono::steady_clock::now();
   //std::cout << "n_points = " << n_points << std::endl;
-  for(int i = 0; i < n_points; i++) {
-    const auto path_point_data = tool_path.getToolPathPointInfo(i);
+  int n_points_visited = 0;
+  for (const auto& path_point_data : tool_path) {
+    int i = n_points_visited++;
     if (debug_output) {
       std::cout << "Index: " << i << " , location = (" << path_point_data.location[0] << ", "
                 << path_point_data.location[1] << ", " << path_point_data.location[2] << ")" << std::endl;
@@ -167,18 +253,142 @@ void testSequentialAccess(computational_geometry::ToolPath& tool_path, bool debu
         std::cout << "  Comment: " << *path_point_data.comment << std::endl;
       }
       if (path_point_data.data) {
-        std::cout << "  3D data is there, first element: " << (*path_point_data.data)[0][0][0] << std::endl;
+        std::cout << "  3D data is there, first element: " << (*path_point_data.data)(0, 0, 0) << std::endl;
       }
     }
   }
   auto end = std::chrono::steady_clock::now();
   std::chrono::duration<double> elapsed_seconds = end - start;
-  std::cout << "Sequential access of all points finished, elapsed_time = " << elapsed_seconds.count() << " sec" << std::endl;
+  std::cout << "Sequential access of all " << n_points_visited << " of " << n_points
+            << " points finished, elapsed_time = " << elapsed_seconds.count() << " sec" << std::endl;
+
+  // The same pass reading locations only, metadata of path points is not looked up.
+  start = std::chrono::steady_clock::now();
+  double sum_coord = 0.;
+  for (const auto& path_point_data : tool_path.range<computational_geometry::ToolPathLocationsOnly>()) {
+    sum_coord += path_point_data.location[0];
+  }
+  end = std::chrono::steady_clock::now();
+  elapsed_seconds = end - start;
+  std::cout << "Sequential access of locations of all points finished, sum of x = " << sum_coord
+            << ", elapsed_time = " << elapsed_seconds.count() << " sec" << std::endl;
   report_memory();
 }
 
+/// @brief Test of parallel full pass over all path points: count annotated points and find maximal coordinate.
+void testParallelAccess(const computational_geometry::ToolPath& tool_path) {
+  std::cout << "Parallel access of all path points with " << omp_get_max_threads() << " threads..." << std::endl;
+  auto start = std::chrono::steady_clock::now();
+  // Each pass reads only attributes it needs.
+  int n_comments = computational_geometry::parallelCountIf<computational_geometry::ToolPathWithComments>(tool_path,
+    [](const computational_geometry::ToolPathPointView& point_view) {
+      return point_view.comment.has_value();
+    });
+  int n_data = computational_geometry::parallelCountIf<computational_geometry::ToolPathWithData>(tool_path,
+    [](const computational_geometry::ToolPathPointView& point_view) {
+      return point_view.data.has_value();
+    });
+  float max_coord = computational_geometry::parallelTransformReduce<computational_geometry::ToolPathLocationsOnly>(
+    tool_path, std::numeric_limits<float>::lowest(),
+    [](float a, float b) { return std::max(a, b); },
+    [](const computational_geometry::ToolPathPointView& point_view) {
+      return std::max({point_view.location[0], point_view.location[1], point_view.location[2]});
+    });
+  auto end = std::chrono::steady_clock::now();
+  std::chrono::duration<double> elapsed_seconds = end - start;
+  std::cout << "Parallel access finished (3 passes), points with comments = " << n_comments << ", points with data = " << n_data
+            << ", max coordinate = " << max_coord << ", elapsed_time = " << elapsed_seconds.count() << " sec" << std::endl;
+}
+
+/// @brief Test of location compression of the path copy: memory of location runs, maximal error and
+/// sequential access time are compared.
+void testLocationCompression(const computational_geometry::ToolPath& tool_path, float tolerance) {
+  std::cout << "Compressing locations of ToolPath copy with tolerance " << tolerance << "..." << std::endl;
+  computational_geometry::ToolPath tool_path_compressed(tool_path);
+  auto start = std::chrono::steady_clock::now();
+  tool_path_compressed.compressLocations(tolerance);
+  auto end = std::chrono::steady_clock::now();
+  std::chrono::duration<double> elapsed_seconds = end - start;
+  std::cout << "Locations compressed, memory of location runs = " << tool_path.locationsMemoryUsage() / 1024 << " kB -> "
+            << tool_path_compressed.locationsMemoryUsage() / 1024 << " kB, elapsed_time = "
+            << elapsed_seconds.count() << " sec" << std::endl;
+
+  start = std::chrono::steady_clock::now();
+  float max_error = 0.;
+  auto iter = tool_path_compressed.cbegin();
+  for (const auto& point_view : tool_path) {
+    for (int coord_index = 0; coord_index < 3; coord_index++) {
+      max_error = std::max(max_error, std::abs(point_view.location[coord_index] - iter->location[coord_index]));
+    }
+    ++iter;
+  }
+  end = std::chrono::steady_clock::now();
+  elapsed_seconds = end - start;
+  std::cout << "Sequential access of compressed and original paths finished, max location error = " << max_error
+            << ", elapsed_time = " << elapsed_seconds.count() << " sec" << std::endl;
+
+  // Coordinates up to 1e5 far from the base point: float spacing there exceeds the tolerance,
+  // chunks which can not be restored within tolerance are left uncompressed.
+  const int n_large_points = 20000;
+  computational_geometry::ToolPath tool_path_large(n_large_points);
+  std::default_random_engine generator;
+  std::uniform_real_distribution<float> coordinate_distribution(0., 1.e5);
+  computational_geometry::Vector3D location{0., 0., 0.};
+  for (int i = 0; i < n_large_points; i++) {
+    location[i % 3] = coordinate_distribution(generator);
+    tool_path_large.setLocation(i, location);
+  }
+  const float large_tolerance = 1.e-3;
+  computational_geometry::ToolPath tool_path_large_compressed(tool_path_large);
+  tool_path_large_compressed.compressLocations(large_tolerance);
+  float max_large_error = 0.;
+  for (int i = 0; i < n_large_points; i++) {
+    const auto expected_location = tool_path_large.getToolPathPointView(i).location;
+    const auto restored_location = tool_path_large_compressed.getToolPathPointView(i).location;
+    for (int coord_index = 0; coord_index < 3; coord_index++) {
+      max_large_error = std::max(max_large_error, std::abs(expected_location[coord_index] - restored_location[coord_index]));
+    }
+  }
+  std::cout << "Compression of locations up to 1e5 with tolerance " << large_tolerance << ", max location error = "
+            << max_large_error << (max_large_error <= large_tolerance ? " (within tolerance)" : " (EXCEEDS TOLERANCE)")
+            << std::endl;
+}
+
+/// @brief Test of box, radius and nearest point queries around random path points.
+void testSpatialQueries(const computational_geometry::ToolPath& tool_path,
+                        const computational_geometry::ToolPathSpatialIndex& spatial_index, int n_queries) {
+  std::cout << "Performing " << n_queries << " box, radius and nearest point queries..." << std::endl;
+  auto start = std::chrono::steady_clock::now();
+  std::default_random_engine point_index_generator;
+  std::uniform_int_distribution<int> point_index_distribution(0, tool_path.numPoints() - 1);
+  const float query_size = 10.;
+  long long n_points_in_boxes = 0;
+  long long n_points_in_spheres = 0;
+  int n_nearest_found = 0;
+  for (int i = 0; i < n_queries; i++) {
+    const auto center = tool_path.getToolPathPointView(point_index_distribution(point_index_generator)).location;
+    computational_geometry::BoundingBox3D box;
+    box.min = {center[0] - query_size, center[1] - query_size, center[2] - query_size};
+    box.max = {center[0] + query_size, center[1] + query_size, center[2] + query_size};
+    for (const auto& range : spatial_index.findInBox(box)) {
+      n_points_in_boxes += range.size();
+    }
+    for (const auto& range : spatial_index.findInRadius(center, query_size)) {
+      n_points_in_spheres += range.size();
+    }
+    if (spatial_index.findNearest({center[0] + 0.5f, center[1] + 0.5f, center[2] + 0.5f}) >= 0) {
+      n_nearest_found++;
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  std::chrono::duration<double> elapsed_seconds = end - start;
+  std::cout << "Spatial queries finished, points in boxes = " << n_points_in_boxes << ", points in spheres = "
+            << n_points_in_spheres << ", nearest points found = " << n_nearest_found
+            << ", elapsed_time = " << elapsed_seconds.count() << " sec" << std::endl;
+}
+
 /// @brief Test for performance for random access of percentage_of_points_to_access% of the data.
-void testRandomAccess(computational_geometry::ToolPath& tool_path, double percentage_of_points_to_access, bool debug_output) {
+void testRandomAccess(const computational_geometry::ToolPath& tool_path, double percentage_of_points_to_access, bool debug_output) {
   int n_points = tool_path.numPoints();
   int n_points_to_query = std::clamp(static_cast<int>((percentage_of_points_to_access / 100.) * n_points), 1, n_points);
   //std::cout << "n_points_to_query = " << n_points_to_query << std::endl;
@@ -189,7 +399,7 @@ void testRandomAccess(computational_geometry::ToolPath& tool_path, double percen
   for(int i = 0; i < n_points_to_query; i++) {
     int point_index = point_index_distribution(point_index_generator);
     //std::cout << "point index = " << point_index << std::endl;
-    const auto path_point_data = tool_path.getToolPathPointInfo(point_index);
+    const auto path_point_data = tool_path.getToolPathPointView(point_index);
     if (debug_output) {
       std::cout << "Index: " << i << " , location = (" << path_point_data.location[0] << ", "
                 << path_point_data.location[1] << ", " << path_point_data.location[2] << ")" << std::endl;
@@ -197,7 +407,7 @@ void testRandomAccess(computational_geometry::ToolPath& tool_path, double percen
         std::cout << "  Comment: " << *path_point_data.comment << std::endl;
       }
       if (path_point_data.data) {
-        std::cout << "  3D data is there, first element: " << (*path_point_data.data)[0][0][0] << std::endl;
+        std::cout << "  3D data is there, first element: " << (*path_point_data.data)(0, 0, 0) << std::endl;
       }
     }
   }
@@ -207,6 +417,43 @@ void testRandomAccess(computational_geometry::ToolPath& tool_path, double percen
   report_memory();
 }
 
+/// @brief Test of performance for batch random access: the same points as in testRandomAccess are gathered
+/// in one call into structure-of-arrays buffers, results are checked against per-point access.
+void testBatchRandomAccess(const computational_geometry::ToolPath& tool_path, double percentage_of_points_to_access) {
+  int n_points = tool_path.numPoints();
+  int n_points_to_query = std::clamp(static_cast<int>((percentage_of_points_to_access / 100.) * n_points), 1, n_points);
+  std::cout << "Performing batch random access of " << percentage_of_points_to_access << "% of the path points"<< std::endl;
+  std::default_random_engine point_index_generator;
+  std::uniform_int_distribution<int> point_index_distribution(0, n_points - 1);
+  std::vector<computational_geometry::ToolPathIndex> point_indices(n_points_to_query);
+  for (auto& point_index : point_indices) {
+    point_index = point_index_distribution(point_index_generator);
+  }
+
+  std::vector<float> x(n_points_to_query), y(n_points_to_query), z(n_points_to_query);
+  std::vector<uint64_t> has_comment(computational_geometry::ToolPathPointBatch::numBitmapWords(n_points_to_query));
+  std::vector<uint64_t> has_data(has_comment.size());
+  computational_geometry::ToolPathPointBatch batch{x.data(), y.data(), z.data(), has_comment.data(), has_data.data()};
+  auto start = std::chrono::steady_clock::now();
+  tool_path.gather(point_indices, batch);
+  auto end = std::chrono::steady_clock::now();
+  std::chrono::duration<double> elapsed_seconds = end - start;
+
+  // Check each 100th point of the batch.
+  int n_mismatches = 0;
+  for (int i = 0; i < n_points_to_query; i += 100) {
+    const auto path_point_data = tool_path.getToolPathPointView(point_indices[i]);
+    if (path_point_data.location != computational_geometry::Vector3D{x[i], y[i], z[i]} ||
+        path_point_data.comment.has_value() != computational_geometry::ToolPathPointBatch::test(has_comment.data(), i) ||
+        path_point_data.data.has_value() != computational_geometry::ToolPathPointBatch::test(has_data.data(), i)) {
+      n_mismatches++;
+    }
+  }
+  std::cout << "Batch random access of path points finished, mismatches = " << n_mismatches
+            << ", elapsed_time = " << elapsed_seconds.count() << " sec" << std::endl;
+  report_memory();
+}
+
 /// @brief Test of performance for downgrading points to the minimum (no metadata).
 void testMetadataCleanup(computational_geometry::ToolPath& tool_path) {
   std::cout << "Performing cleanup of metadata for all path points..." << std::endl;
@@ -270,13 +517,287 @@ void testRandomSinglePointInsertion(computational_geometry::ToolPath& tool_path,
     }
     tool_path.InsertPathPointAtCurrentPosition(location, comment_cur, data3d_cur);
   }
-  tool_path.updatePointIndices();
   auto end = std::chrono::steady_clock::now();
   std::chrono::duration<double> elapsed_seconds = end - start;
   std::cout << "Random insertion of path points finished, elapsed_time = " << elapsed_seconds.count() << " sec" << std::endl;
   report_memory();
 }
 
+/// @brief Test for performance to randomly insert percentage_of_points_to_insert% new nodes with random metadata
+/// using bulk insertion in one pass.
+void testRandomBulkPointInsertion(computational_geometry::ToolPath& tool_path, double percentage_of_points_to_insert,
+                                  double nodes_percentage_with_string_data, double nodes_percentage_with_3d_vector, 
+                                  int vector_data_size) {
+  int n_points = tool_path.numPoints();
+  std::cout << "Performing random bulk insertion of " << percentage_of_points_to_insert << "% of the new path points"<< std::endl;
+  int n_new_points = std::clamp(static_cast<int>((percentage_of_points_to_insert / 100.) * n_points), 1, n_points);
+  std::default_random_engine point_index_generator;
+  std::uniform_int_distribution<int> point_index_distribution(0, n_points);
+  std::default_random_engine location_generator;
+  std::uniform_real_distribution<float> location_distribution(-1e+06, 1e+06);
+  std::default_random_engine metadata_probability_generator;
+  std::uniform_real_distribution<float> metadata_probability_distribution(0., 1.0);
+  std::string comment_str(100, 'z');
+  std::vector<float> data_1d(vector_data_size, 0.); // All 0s.
+  std::vector<std::vector<float>> data_2d(vector_data_size, data_1d);
+  computational_geometry::Data3D data_3d(vector_data_size, data_2d);
+  float probability_comment = nodes_percentage_with_string_data / 100.;
+  float probability_data = nodes_percentage_with_3d_vector / 100.;
+  auto start = std::chrono::steady_clock::now();
+  std::vector<computational_geometry::ToolPathPointInsertion> insertions(n_new_points);
+  for (auto& insertion : insertions) {
+    insertion.point_index = point_index_distribution(point_index_generator);
+    float x = location_distribution(location_generator);
+    float y = location_distribution(location_generator);
+    float z = location_distribution(location_generator);
+    insertion.location = computational_geometry::Vector3D{x, y, z};
+
+    // As in the original tool_path object, 1% of new path points must have comment string.
+    if (metadata_probability_distribution(metadata_probability_generator) < probability_comment) {
+      insertion.comment = comment_str;
+    }
+
+    // As in the original tool_path object, 0.1% of new path points must have Data3D annotated.
+    if (metadata_probability_distribution(metadata_probability_generator) < probability_data) {
+      insertion.data = data_3d;
+    }
+  }
+  tool_path.insertPoints(insertions);
+  auto end = std::chrono::steady_clock::now();
+  std::chrono::duration<double> elapsed_seconds = end - start;
+  std::cout << "Random bulk insertion of path points finished, combined ToolPath size = " << tool_path.numPoints()
+            << ", elapsed_time = " << elapsed_seconds.count() << " sec" << std::endl;
+  report_memory();
+}
+
+/// @brief Test of performance to erase n_ranges random ranges of range_size points (like trimming of air moves),
+/// then compact the path.
+void testRangeErase(computational_geometry::ToolPath& tool_path, int n_ranges, int range_size) {
+  std::cout << "Erasing " << n_ranges << " random ranges of " << range_size << " path points..." << std::endl;
+  auto start = std::chrono::steady_clock::now();
+  std::default_random_engine point_index_generator;
+  for (int i = 0; i < n_ranges; i++) {
+    int n_points = tool_path.numPoints();
+    int first_point_index = std::uniform_int_distribution<int>(0, n_points - 1)(point_index_generator);
+    tool_path.erase(first_point_index, std::min(first_point_index + range_size, n_points));
+  }
+  auto end = std::chrono::steady_clock::now();
+  std::chrono::duration<double> elapsed_seconds = end - start;
+  std::cout << "Erase of path points finished, ToolPath size = " << tool_path.numPoints()
+            << ", elapsed_time = " << elapsed_seconds.count() << " sec" << std::endl;
+
+  std::cout << "Compacting ToolPath..." << std::endl;
+  start = std::chrono::steady_clock::now();
+  tool_path.compact();
+  end = std::chrono::steady_clock::now();
+  elapsed_seconds = end - start;
+  std::cout << "Compaction finished, elapsed_time = " << elapsed_seconds.count() << " sec" << std::endl;
+  report_memory();
+}
+
+/// @brief Test of concurrent readers: writer edits the path and publishes new versions while reader threads
+/// randomly access pinned versions.
+void testConcurrentReaders(const computational_geometry::ToolPath& tool_path, int n_versions, int n_readers) {
+  std::cout << "Publishing " << n_versions << " versions of ToolPath to " << n_readers << " concurrent readers..." << std::endl;
+  computational_geometry::ToolPathVersions versions(tool_path);
+  std::atomic<bool> writer_done{false};
+  std::atomic<long long> n_points_read{0};
+  std::atomic<long long> n_commented_read{0};
+  std::atomic<long long> n_snapshots{0};
+  std::vector<std::thread> readers;
+  for (int i = 0; i < n_readers; i++) {
+    readers.emplace_back([&versions, &writer_done, &n_points_read, &n_commented_read, &n_snapshots, i]() {
+      std::default_random_engine point_index_generator(i);
+      do {
+        const auto snapshot = versions.snapshot();
+        std::uniform_int_distribution<int> point_index_distribution(0, snapshot->numPoints() - 1);
+        int n_comments = 0;
+        for (int j = 0; j < 1000; j++) {
+          n_comments += snapshot->getToolPathPointView(point_index_distribution(point_index_generator)).comment.has_value();
+        }
+        n_points_read += 1000;
+        n_commented_read += n_comments;
+        n_snapshots++;
+      } while (!writer_done);
+    });
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  std::default_random_engine point_index_generator;
+  for (int i = 0; i < n_versions; i++) {
+    auto& working_path = versions.writer();
+    std::uniform_int_distribution<int> point_index_distribution(0, working_path.numPoints() - 1);
+    const std::string comment = "Edited in version " + std::to_string(i + 2);
+    for (int j = 0; j < 100; j++) {
+      working_path.setComment(point_index_distribution(point_index_generator), comment);
+    }
+    versions.publish();
+  }
+  auto end = std::chrono::steady_clock::now();
+  writer_done = true;
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  std::chrono::duration<double> elapsed_seconds = end - start;
+  std::cout << "Versions published, last version = " << versions.version() << ", retired versions held by readers = "
+            << versions.reclaim() << ", reader snapshots = " << n_snapshots << ", points read = " << n_points_read
+            << " (" << n_commented_read << " with comments)"
+            << ", elapsed_time = " << elapsed_seconds.count() << " sec" << std::endl;
+  report_memory();
+}
+
+/// @brief Test of saving ToolPath to binary snapshot, access through memory mapping and loading it back.
+void testSnapshot(const computational_geometry::ToolPath& tool_path, double percentage_of_points_to_access) {
+  const std::string file_name = "tool_path_snapshot.bin";
+  std::cout << "Saving ToolPath snapshot..." << std::endl;
+  auto start = std::chrono::steady_clock::now();
+  computational_geometry::ToolPathSnapshot::save(tool_path, file_name);
+  auto end = std::chrono::steady_clock::now();
+  std::chrono::duration<double> elapsed_seconds = end - start;
+  std::cout << "Snapshot saved, elapsed_time = " << elapsed_seconds.count() << " sec" << std::endl;
+
+  {
+    start = std::chrono::steady_clock::now();
+    computational_geometry::ToolPathSnapshot snapshot(file_name);
+    end = std::chrono::steady_clock::now();
+    elapsed_seconds = end - start;
+    std::cout << "Snapshot mapped, elapsed_time = " << elapsed_seconds.count() << " sec" << std::endl;
+
+    int n_points = snapshot.numPoints();
+    int n_points_to_query = n_points * percentage_of_points_to_access / 100.;
+    int n_mismatches = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n_points_to_query; i++) {
+      int point_index = rand() % n_points;
+      const auto point_view = snapshot.getToolPathPointView(point_index);
+      const auto point_view_expected = tool_path.getToolPathPointView(point_index);
+      if (point_view.location != point_view_expected.location || point_view.comment != point_view_expected.comment ||
+          point_view.data.has_value() != point_view_expected.data.has_value()) {
+        n_mismatches++;
+      }
+    }
+    end = std::chrono::steady_clock::now();
+    elapsed_seconds = end - start;
+    std::cout << "Random access of " << percentage_of_points_to_access << "% of snapshot path points finished, mismatches = "
+              << n_mismatches << ", elapsed_time = " << elapsed_seconds.count() << " sec" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    const auto tool_path_loaded = snapshot.toToolPath();
+    end = std::chrono::steady_clock::now();
+    elapsed_seconds = end - start;
+    std::cout << "ToolPath loaded from snapshot, size = " << tool_path_loaded.numPoints()
+              << ", elapsed_time = " << elapsed_seconds.count() << " sec" << std::endl;
+  }
+
+  std::remove(file_name.c_str());
+  report_memory();
+}
+
+/// @brief Test of snapshot validation: truncated and randomly corrupted copies of a snapshot of the path head
+/// must be rejected on open or stay readable (no out-of-bounds reads for any accepted file).
+void testSnapshotCorruption(const computational_geometry::ToolPath& tool_path, int n_corruptions) {
+  const std::string file_name = "tool_path_snapshot_corrupted.bin";
+  std::cout << "Opening " << n_corruptions << " corrupted snapshots..." << std::endl;
+  computational_geometry::ToolPath tool_path_head(tool_path);
+  tool_path_head.erase(std::min<computational_geometry::ToolPathIndex>(tool_path_head.numPoints(), 5000),
+                     tool_path_head.numPoints());
+  computational_geometry::ToolPathSnapshot::save(tool_path_head, file_name);
+  std::vector<char> content;
+  {
+    std::ifstream stream(file_name, std::ios::binary);
+    content.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  std::default_random_engine generator;
+  std::uniform_int_distribution<size_t> word_distribution(0, content.size() / sizeof(int32_t) - 1);
+  int n_rejected = 0;
+  for (int i = 0; i <= n_corruptions; i++) {
+    // The first file is truncated, others have one 32-bit word overwritten.
+    std::vector<char> corrupted(content);
+    if (i == 0) {
+      corrupted.resize(corrupted.size() / 2);
+    } else {
+      const int32_t values[] = {-1, std::numeric_limits<int32_t>::max(), 1 << 20};
+      std::memcpy(corrupted.data() + word_distribution(generator) * sizeof(int32_t), &values[i % 3], sizeof(int32_t));
+    }
+    {
+      std::ofstream stream(file_name, std::ios::binary | std::ios::trunc);
+      stream.write(corrupted.data(), corrupted.size());
+    }
+
+    try {
+      computational_geometry::ToolPathSnapshot snapshot(file_name);
+      for (int point_index = 0; point_index < snapshot.numPoints(); point_index++) {
+        snapshot.getToolPathPointView(point_index);
+      }
+      snapshot.toToolPath();
+    } catch (const std::runtime_error&) {
+      n_rejected++;
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  std::chrono::duration<double> elapsed_seconds = end - start;
+  std::cout << "Corrupted snapshots checked, rejected = " << n_rejected << " of " << n_corruptions + 1
+            << ", elapsed_time = " << elapsed_seconds.count() << " sec" << std::endl;
+
+  std::remove(file_name.c_str());
+}
+
+/// @brief Test of journaling random edits of ToolPath copy to append-only file and recovering the path
+/// from snapshot and journal.
+void testJournal(const computational_geometry::ToolPath& tool_path, int n_edits) {
+  const std::string snapshot_file_name = "tool_path_journal_snapshot.bin";
+  const std::string journal_file_name = "tool_path_journal.bin";
+  std::cout << "Journaling " << n_edits << " random edits of ToolPath..." << std::endl;
+  computational_geometry::ToolPath tool_path_edited(tool_path);
+  int n_points = tool_path_edited.numPoints();
+  {
+    auto start = std::chrono::steady_clock::now();
+    computational_geometry::ToolPathJournal journal(tool_path_edited, snapshot_file_name, journal_file_name);
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed_seconds = end - start;
+    std::cout << "Journal attached with initial checkpoint, elapsed_time = " << elapsed_seconds.count() << " sec"
+              << std::endl;
+
+    std::default_random_engine generator;
+    std::uniform_int_distribution<int> point_index_distribution(0, n_points - 1);
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n_edits; i++) {
+      int point_index = point_index_distribution(generator);
+      if (i % 2 == 0) {
+        tool_path_edited.setComment(point_index, "Journaled edit " + std::to_string(i));
+      } else {
+        tool_path_edited.setLocation(point_index, {static_cast<float>(i), 0., 0.});
+      }
+    }
+    journal.sync();
+    end = std::chrono::steady_clock::now();
+    elapsed_seconds = end - start;
+    std::cout << "Edits journaled, journal size = " << journal.journalSize()
+              << " bytes, elapsed_time = " << elapsed_seconds.count() << " sec" << std::endl;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  const auto tool_path_recovered = computational_geometry::ToolPathJournal::recover(snapshot_file_name, journal_file_name);
+  auto end = std::chrono::steady_clock::now();
+  std::chrono::duration<double> elapsed_seconds = end - start;
+  int n_mismatches = 0;
+  for (int i = 0; i < n_points; i += 1000) {
+    const auto point_view = tool_path_recovered.getToolPathPointView(i);
+    const auto point_view_expected = tool_path_edited.getToolPathPointView(i);
+    if (point_view.location != point_view_expected.location || point_view.comment != point_view_expected.comment) {
+      n_mismatches++;
+    }
+  }
+  std::cout << "ToolPath recovered, size = " << tool_path_recovered.numPoints() << ", mismatches of sampled points = "
+            << n_mismatches << ", elapsed_time = " << elapsed_seconds.count() << " sec" << std::endl;
+
+  std::remove(snapshot_file_name.c_str());
+  std::remove(journal_file_name.c_str());
+  report_memory();
+}
+
 int main (const int argc, char **const argv) 
 {
   if (argc != 1) {
@@ -300,16 +821,64 @@ int main (const int argc, char **const argv)
                nodes_percentage_with_string_data, nodes_percentage_with_3d_vector);
   auto end = std::chrono::steady_clock::now();
   std::chrono::duration<double> elapsed_seconds = end - start;
-  std::cout << "ToolPath object created, elapsed_time = " << elapsed_seconds.count() << " sec" << std::endl;
+  std::cout << "ToolPath object created, memory of data tensors = " << tool_path.dataMemoryUsage() / 1024
+            << " kB, elapsed_time = " << elapsed_seconds.count() << " sec" << std::endl;
   report_memory();
 
+  // 1a. Create the same ToolPath with streaming builder adding path points in order.
+  {
+    std::cout << "Building ToolPath object with streaming builder..." << std::endl;
+    start = std::chrono::steady_clock::now();
+    computational_geometry::ToolPathBuilder builder;
+    buildToolPath(builder, n_points_total, step_coord_change_avg, vector_data_size,
+                  nodes_percentage_with_string_data, nodes_percentage_with_3d_vector);
+    const auto tool_path_built = builder.build();
+    end = std::chrono::steady_clock::now();
+    elapsed_seconds = end - start;
+    int n_mismatches = 0;
+    for (int i = 0; i < n_points_total; i += 997) {
+      const auto point_view = tool_path_built.getToolPathPointView(i);
+      const auto point_view_expected = tool_path.getToolPathPointView(i);
+      if (point_view.location != point_view_expected.location || point_view.comment != point_view_expected.comment ||
+          point_view.data.has_value() != point_view_expected.data.has_value()) {
+        n_mismatches++;
+      }
+    }
+    std::cout << "ToolPath object built, mismatches = " << n_mismatches
+              << ", elapsed_time = " << elapsed_seconds.count() << " sec" << std::endl;
+  }
+
+  // 1b. Track performance of saving ToolPath to snapshot file and using it.
+  testSnapshot(tool_path, 10.);
+  testSnapshotCorruption(tool_path, 1000);
+
   // 2. Track performance for sequential access of all data (full toolpath).
   testSequentialAccess(tool_path, debug_output);
   
+  // 2a. Track performance for parallel access of all data.
+  testParallelAccess(tool_path);
+
+  // 2b. Track memory and sequential access performance of path with compressed locations.
+  testLocationCompression(tool_path, 1e-3);
+
+  // 2c. Track performance of spatial index creation and spatial queries.
+  {
+    std::cout << "Building spatial index..." << std::endl;
+    start = std::chrono::steady_clock::now();
+    computational_geometry::ToolPathSpatialIndex spatial_index(tool_path);
+    end = std::chrono::steady_clock::now();
+    elapsed_seconds = end - start;
+    std::cout << "Spatial index built, elapsed_time = " << elapsed_seconds.count() << " sec" << std::endl;
+    testSpatialQueries(tool_path, spatial_index, 1000);
+  }
+
   // 3. Track performance for random access of 10% of the data.
   double percentage_of_points_to_access = 10.;
   testRandomAccess(tool_path, percentage_of_points_to_access, debug_output);
 
+  // 3a. Track performance for batch random access of the same points.
+  testBatchRandomAccess(tool_path, percentage_of_points_to_access);
+
   // 4. Track performance for downgrading points to the minimum 
   //    (replace all upgraded nodes with simplest version with no metadata).
   testMetadataCleanup(tool_path);
@@ -319,6 +888,19 @@ int main (const int argc, char **const argv)
   testRandomSinglePointInsertion(tool_path, percentage_of_points_to_insert, 
                                  nodes_percentage_with_string_data, nodes_percentage_with_3d_vector, vector_data_size);
 
+  // 5a. Track performance to randomly insert 10% new nodes with random metadata in one bulk operation.
+  testRandomBulkPointInsertion(tool_path, percentage_of_points_to_insert,
+                               nodes_percentage_with_string_data, nodes_percentage_with_3d_vector, vector_data_size);
+
+  // 5b. Track performance to erase 1% of points in 1000 random ranges and compact the path.
+  testRangeErase(tool_path, 1000, n_points_total / 100000);
+
+  // 5c. Track performance of publishing edited versions of the path to concurrent readers.
+  testConcurrentReaders(tool_path, 100, 2);
+
+  // 5d. Track performance of journaling edits of the path and recovering it.
+  testJournal(tool_path, 100000);
+
   // Clear contents of the existing tool_path - we don't need it anymore.
   tool_path.clear();
 
@@ -336,6 +918,7 @@ int main (const int argc, char **const argv)
   elapsed_seconds = end - start;
   std::cout << "2 ToolPath objects created, elapsed_time = " << elapsed_seconds.count() << " sec" << std::endl;
   report_memory();
+  computational_geometry::ToolPathSpatialIndex spatial_index_main(tool_path_main);
 
   // 7. Making a copy of tool_path2 - we'll need it later for insertion test.
   std::cout << "Making a copy of the second ToolPath..." << std::endl;
@@ -366,6 +949,15 @@ int main (const int argc, char **const argv)
             << ", elapsed_time = " << elapsed_seconds.count() << " sec" << std::endl;
   report_memory();
 
+  // 9a. Update spatial index of the first path after append and insertion.
+  std::cout << "Updating spatial index of combined ToolPath..." << std::endl;
+  start = std::chrono::steady_clock::now();
+  spatial_index_main.update();
+  end = std::chrono::steady_clock::now();
+  elapsed_seconds = end - start;
+  std::cout << "Spatial index updated, elapsed_time = " << elapsed_seconds.count() << " sec" << std::endl;
+  testSpatialQueries(tool_path_main, spatial_index_main, 1000);
+
   // Clear contents of the existing tool_path_main - we don't need it anymore.
   tool_path_main.clear();
 
@@ -381,7 +973,7 @@ int main (const int argc, char **const argv)
     computational_geometry::ToolPath sub_path(n_points_sub_path);
     fillToolPath(sub_path, step_coord_change_avg, vector_data_size, 
                  nodes_percentage_with_string_data, nodes_percentage_with_3d_vector);
-    tool_paths.push_back(sub_path);
+    tool_paths.push_back(std::move(sub_path));
   }
   end = std::chrono::steady_clock::now();
   elapsed_seconds = end - start;
@@ -398,7 +990,6 @@ int main (const int argc, char **const argv)
   for (int i = 1; i < n_sub_paths; i++) {
     tool_path_combined.append(tool_paths[i]);
   }
-  tool_path_combined.updatePointIndices();
   end = std::chrono::steady_clock::now();
   elapsed_seconds = end - start;
   std::cout << "Sequential concatenation done, combined ToolPath size = " << tool_path_combined.numPoints() 
@@ -409,16 +1000,18 @@ int main (const int argc, char **const argv)
   tool_path_combined.clear();
 
   // 12. Create 1000 paths with 100000 points each and store them in vector.
+  // Paths are allocated from common memory pool which is released at once.
   std::cout << "Creation of " << n_sub_paths << " ToolPaths of " << n_points_sub_path 
-            << " size each and add them into the vector of pre-calculated ToolPaths..." << std::endl;
+            << " size each (allocated from memory pool) and add them into the vector of pre-calculated ToolPaths..." << std::endl;
   start = std::chrono::steady_clock::now();
+  std::pmr::unsynchronized_pool_resource sub_paths_resource;
   std::vector<computational_geometry::ToolPath> tool_paths2;
   tool_paths2.reserve(n_sub_paths);
   for (int i = 0; i < n_sub_paths; i++) {
-    computational_geometry::ToolPath sub_path(n_points_sub_path);
+    computational_geometry::ToolPath sub_path(n_points_sub_path, &sub_paths_resource);
     fillToolPath(sub_path, step_coord_change_avg, vector_data_size, 
                  nodes_percentage_with_string_data, nodes_percentage_with_3d_vector);
-    tool_paths2.push_back(sub_path);
+    tool_paths2.push_back(std::move(sub_path));
   }
   end = std::chrono::steady_clock::now();
   elapsed_seconds = end - start;
@@ -436,6 +1029,16 @@ int main (const int argc, char **const argv)
   std::cout << "Multiple concatenation done, combined ToolPath size = " << tool_path_combined2.numPoints() 
             << ", elapsed_time = " << elapsed_seconds.count() << " sec" << std::endl;
   report_memory();
+
+  // 14. Release combined path together with its memory pool.
+  std::cout << "Releasing combined ToolPath and its memory pool..." << std::endl;
+  start = std::chrono::steady_clock::now();
+  tool_path_combined2.clear();
+  sub_paths_resource.release();
+  end = std::chrono::steady_clock::now();
+  elapsed_seconds = end - start;
+  std::cout << "Release done, elapsed_time = " << elapsed_seconds.count() << " sec" << std::endl;
+  report_memory();
   
   return 0;
 }
@@ -0,0 +1,34 @@
+#include <tool_path_versions.h>
+
+#include <algorithm>
+
+namespace computational_geometry {
+
+ToolPathVersions::ToolPathVersions(const ToolPath& tool_path) : m_working(tool_path) {
+  publish();
+}
+
+void ToolPathVersions::publish() {
+  auto version = std::make_shared<const ToolPath>(m_working);
+  auto replaced = std::atomic_exchange(&m_published, std::shared_ptr<const ToolPath>(std::move(version)));
+  m_version.fetch_add(1, std::memory_order_release);
+  if (replaced) {
+    m_retired.push_back(std::move(replaced));
+  }
+  reclaim();
+}
+
+int ToolPathVersions::reclaim() {
+  // Retired versions can not be pinned anymore, the only way their use count drops to one is
+  // that all readers released them. Fence orders reader accesses before the release here.
+  for (auto& version : m_retired) {
+    if (version.use_count() == 1) {
+      std::atomic_thread_fence(std::memory_order_acquire);
+      version.reset();
+    }
+  }
+  m_retired.erase(std::remove(m_retired.begin(), m_retired.end(), nullptr), m_retired.end());
+  return m_retired.size();
+}
+
+} // namespace computational_geometry